@@ -2,6 +2,12 @@
 #include <SFML/Graphics.hpp> // Include for graphical components (like rendering text, shapes, etc.)
 #include <SFML/Window.hpp>  // Include for handling window events and input
 #include <iostream>  // For std::cout, std::cin (optional debug)
+#include <cstring>   // For strcmp on the command line arguments
+#include <cstdlib>   // For strtol on the --undo-limit argument
+#include <ctime>     // For the CPU time of the session
+#include <algorithm> // For std::min
+#include "eventLog.h"  // For recording the session with --record
+#include "frameStats.h"  // For the instrumentation overlay and the --metrics export
 
 class FileInputPopup {
 public:
@@ -123,7 +129,32 @@ private:
     sf::Text cancelButtonText;
 };
 
-int main() {
+// Longest sleep of the idle loop while the window has the focus (the latency added to the next event)
+const int IDLE_POLL_MS = 10;
+
+int main(int argc, char** argv) {
+    // Print the latest traces if the editor crashes
+    Trace::installCrashHandler();
+
+    // "--record <file>" writes every input of the session to a file that the replay benchmark can play back
+    // "--metrics <file>" writes the counters of every frame to a CSV file (or JSON when it ends with .json) at exit
+    // "--undo-limit <MB>" changes how much memory the undo history may use before its oldest edits are dropped
+    EventLog eventLog;
+    std::string metricsFile;
+    long undoLimitMB = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--record") == 0 && !eventLog.openForWriting(argv[i + 1])) {
+            std::cerr << "Failed to open " << argv[i + 1] << " for recording" << std::endl;
+        } else if (strcmp(argv[i], "--metrics") == 0) {
+            metricsFile = argv[i + 1];
+        } else if (strcmp(argv[i], "--undo-limit") == 0) {
+            undoLimitMB = strtol(argv[i + 1], nullptr, 10);
+            if (undoLimitMB <= 0) {
+                std::cerr << "Invalid undo limit " << argv[i + 1] << ", keeping the default" << std::endl;
+            }
+        }
+    }
+
     // Create a window with a size of 800x600 and title "Simple Notepad with Blinking Cursor"
     sf::RenderWindow window(sf::VideoMode(800, 600), "Simple Notepad with Blinking Cursor");
 
@@ -132,6 +163,12 @@ int main() {
 
     // Create a TextEditor object to handle text input and rendering
     TextEditor editor;
+    if (undoLimitMB > 0) {
+        editor.setUndoMemoryLimit(static_cast<size_t>(undoLimitMB) << 20);
+    }
+
+    // Every edit is journaled until the editor closes; the edits of a session that crashed are replayed here
+    editor.startRecovery("notepad.journal");
 
     // Create a font object
     sf::Font font;
@@ -157,17 +194,62 @@ int main() {
 
     bool fileInputHandled = false;
 
+    // Counters of every frame, shown by the overlay (F3) and exported with --metrics
+    FrameStats frameStats;
+    sf::Clock frameClock;    // Time between the start of two frames
+    sf::Clock sectionClock;  // Time of each part of a frame
+    FrameSample sample = FrameSample();  // Counters of the frame being prepared
+
+    // A frame is only drawn when something on screen changed: an event, an edit, the cursor blink or the
+    // progress of a background load or search. In between the loop sleeps, so an idle editor uses no CPU.
+    bool redraw = true;       // True when an event handled here changed the scene
+    bool eventWaiting = false; // True when waitEvent returned an event that has not been handled yet
+    sf::Clock cpuWallClock;   // Wall time of the session, to report the CPU usage
+
     // Main event loop: keep the window open as long as it is not closed
     while (window.isOpen()) {
         sf::Event event;  // Create an event object to handle user inputs and system events
 
+        // Nothing to draw: wait for the next event, or until the editor has something to update
+        // While the overlay is shown every frame is drawn, so its frame times stay comparable
+        // Behind the popup the editor is not drawn, so its changes do not count
+        bool editorShown = !fileInputPopup.isVisible();
+        if (!redraw && !(editorShown && editor.needsRedraw()) && !frameStats.isOverlayVisible()) {
+            int wait = editorShown ? editor.millisecondsUntilChange() : -1;
+            if (wait < 0) {
+                eventWaiting = window.waitEvent(event);  // Blocks until the next event, nothing runs meanwhile
+            } else if (wait > 0) {
+                // SFML cannot wait for an event with a timeout, so events are polled in short sleeps
+                sf::sleep(sf::milliseconds(std::min(wait, IDLE_POLL_MS)));
+            }
+        }
+        sectionClock.restart();
+
         // Poll all events from the window
-        while (window.pollEvent(event)) {
+        while (eventWaiting || window.pollEvent(event)) {
+            eventWaiting = false;
+            sample.events++;
+
+            // Moving the mouse does not change the scene; any other event may
+            if (event.type != sf::Event::MouseMoved && event.type != sf::Event::MouseEntered && event.type != sf::Event::MouseLeft) {
+                redraw = true;
+            }
+
             // If the window is closed, close the window
             if (event.type == sf::Event::Closed) {
                 window.close();  // Close the window
             }
 
+            // The cursor only blinks while the window has the focus
+            if (event.type == sf::Event::GainedFocus || event.type == sf::Event::LostFocus) {
+                editor.setFocused(event.type == sf::Event::GainedFocus);
+            }
+
+            // F3 shows or hides the instrumentation overlay
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3) {
+                frameStats.toggleOverlay();
+            }
+
             // Handle file input popup events
             if (fileInputPopup.isVisible()) {
                 if (event.type == sf::Event::TextEntered) {
@@ -187,6 +269,7 @@ int main() {
                         std::string fileName = fileInputPopup.getFileName();
                         if (!fileName.empty()) {
                             editor.readFromFile(fileName);  // Read from file
+                            eventLog.recordFile(ReplayStep::OPEN, fileName);
                         }
                         fileInputPopup.hide();  // Close the popup
                     } else {
@@ -200,13 +283,35 @@ int main() {
                         fileInputPopup.show();  // Show the file input popup
                     }
                 }
-                // Handle other input events (like text input, key presses)
-                editor.handleInput(event);
+                // Ctrl+V pastes the clipboard at the cursor (the text is logged, the clipboard is not replayed)
+                if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::V && event.key.control) {
+                    std::string text = sf::Clipboard::getString().toAnsiString();
+                    eventLog.recordPaste(text);
+                    editor.insertText(text);
+                // Ctrl+S is logged as a save, so a replay can write its own file and wait for it like the editor's frames do
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::S && event.key.control) {
+                    eventLog.recordFile(ReplayStep::SAVE, TextEditor::SAVE_FILE);
+                    editor.saveToFile(TextEditor::SAVE_FILE);
+                } else {
+                    // Handle other input events (like text input, key presses)
+                    eventLog.record(event);
+                    editor.handleInput(event);
+                }
             }
         }
 
+        sample.eventMs += sectionClock.restart().asSeconds() * 1000.f;
+
         // Update the editor state (like blinking cursor)
         editor.update();
+        sample.updateMs += sectionClock.restart().asSeconds() * 1000.f;
+
+        editorShown = !fileInputPopup.isVisible();
+        if (!window.isOpen() || (!redraw && !(editorShown && editor.needsRedraw()) && !frameStats.isOverlayVisible())) {
+            continue;  // The frame on screen is still right
+        }
+        redraw = false;
+        sample.frameMs = frameClock.restart().asSeconds() * 1000.f;
 
         // Clear the window with a white background color
         window.clear(sf::Color::White);
@@ -220,11 +325,35 @@ int main() {
             fileInputPopup.render(window);
         } else {
             // Ensure the text editor starts below the "Open File" button
+            // Only the editor's render call is timed, the 60 FPS limit would hide its cost otherwise
+            sectionClock.restart();
             editor.render(window);
+            sample.renderMs = sectionClock.getElapsedTime().asSeconds() * 1000.f;
+            sample.drawCalls = editor.getDrawCalls();
         }
+        sample.lines = editor.lineCount();
+        sample.bytes = editor.documentBytes();
+        sample.undoBytes = editor.undoMemoryUsage();
+        frameStats.addFrame(sample);
+        frameStats.render(window, font);
 
         // Display the updated window content
         window.display();
+        sample = FrameSample();
+    }
+
+    // Write the counters of the session
+    if (!metricsFile.empty()) {
+        // CPU used by the whole session, to compare an idle editor before and after a change
+        float wallSeconds = cpuWallClock.getElapsedTime().asSeconds();
+        float cpuSeconds = static_cast<float>(std::clock()) / CLOCKS_PER_SEC;
+        std::cout << "CPU time: " << cpuSeconds << " s in " << wallSeconds << " s ("
+                  << (wallSeconds > 0.f ? 100.f * cpuSeconds / wallSeconds : 0.f) << "% of a core)" << std::endl;
+        if (frameStats.exportToFile(metricsFile)) {
+            std::cout << "Frame metrics written to " << metricsFile << std::endl;
+        } else {
+            std::cerr << "Failed to write " << metricsFile << std::endl;
+        }
     }
 
     // Return 0 to indicate that the program ended successfully
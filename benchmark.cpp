@@ -0,0 +1,130 @@
+#include    "pieceTable.h" // Include the header file for the piece table
+#include    "fileSaver.h"  // Include the header file for the background save
+#include    <algorithm>    // For sort when computing percentiles
+#include    <chrono>       // For high resolution timing
+#include    <cstdio>       // For remove
+#include    <fstream>      // For writing the input file
+#include    <iostream>     // Include iostream for the report
+#include    <random>       // For random edit positions
+#include    <string>
+#include    <vector>
+using namespace std; // Use the standard namespace for convenience
+
+// Benchmark for the document engine, it does not need a window or SFML
+// Build: g++ -std=c++17 -O2 -o benchmark benchmark.cpp fileSaver.cpp pieceTable.cpp lineIndex.cpp textScan.cpp mappedFile.cpp -pthread
+
+typedef chrono::steady_clock Clock;
+
+// Function to print the latency summary of one kind of edit
+static void report(const string& name, vector<double>& samples) {
+    sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    cout << name << ": " << samples.size() << " ops"
+         << "  avg " << total / samples.size() << " us"
+         << "  p50 " << samples[samples.size() / 2] << " us"
+         << "  p99 " << samples[samples.size() * 99 / 100] << " us"
+         << "  max " << samples.back() << " us\n";
+}
+
+// Function to time one edit in microseconds
+template <typename Edit>
+static double timeEdit(Edit edit) {
+    Clock::time_point start = Clock::now();
+    edit();
+    return chrono::duration<double, micro>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    // Size of the synthetic document in megabytes (100 MB by default)
+    size_t megabytes = argc > 1 ? stoul(argv[1]) : 100;
+    const size_t operations = 100000;
+
+    // Build a document of 60 character lines
+    string text;
+    text.reserve(megabytes << 20);
+    mt19937 random(42);
+    while (text.size() < (megabytes << 20)) {
+        for (int i = 0; i < 59; i++) {
+            text += static_cast<char>('a' + random() % 26);
+        }
+        text += '\n';
+    }
+
+    // Write the document to a file and open it the way the editor does (memory mapped)
+    const char* inputName = "benchmark_input.txt";
+    {
+        ofstream input(inputName, ios::binary);
+        input.write(text.data(), text.size());
+    }
+    text.clear();
+    text.shrink_to_fit();
+
+    PieceTable document;
+    Clock::time_point loadStart = Clock::now();
+    if (!document.open(inputName)) {
+        cerr << "Failed to open " << inputName << endl;
+        return 1;
+    }
+    double loadTime = chrono::duration<double, milli>(Clock::now() - loadStart).count();
+    cout << "Opened " << megabytes << " MB (" << document.lineCount() << " lines) in " << loadTime << " ms, "
+         << document.memoryUsage() << " bytes of index\n";
+
+    vector<double> typing, backspace, split, merge, lookup;
+
+    // Every round edits a random line: type a few characters, delete one, split the line and join it again
+    for (size_t i = 0; i < operations; i++) {
+        size_t line = random() % document.lineCount();
+        size_t offset = 0;
+        lookup.push_back(timeEdit([&] { offset = document.lineStart(line) + document.lineLength(line) / 2; }));
+
+        for (int key = 0; key < 4; key++) {
+            char ch = static_cast<char>('A' + key);
+            typing.push_back(timeEdit([&] { document.insert(offset + key, &ch, 1); }));
+        }
+        backspace.push_back(timeEdit([&] { document.erase(offset + 3, 1); }));
+        split.push_back(timeEdit([&] { document.insert(offset + 3, "\n", 1); }));
+        merge.push_back(timeEdit([&] { document.erase(offset + 3, 1); }));
+    }
+
+    report("line lookup", lookup);
+    report("type char  ", typing);
+    report("backspace  ", backspace);
+    report("split line ", split);
+    report("merge lines", merge);
+    cout << "Index after the edits: " << document.memoryUsage() << " bytes\n";
+
+    // Replace-all: one range of 3 characters every length / operations characters, all replaced in one pass
+    vector<Replacement> ranges;
+    string texts;
+    size_t step = document.length() / operations;
+    for (size_t i = 0; i < operations; i++) {
+        ranges.push_back(Replacement{i * step, 3, 4});
+        texts += "WXYZ";
+    }
+    double replaceTime = timeEdit([&] { document.replaceRanges(ranges, texts); });
+    cout << "replace all: " << ranges.size() << " ranges in " << replaceTime / 1000 << " ms, "
+         << document.lineCount() << " lines after\n";
+
+    // Saving the edited document: the editor only waits for the snapshot, the worker writes and flushes the file
+    string outputName = string(inputName) + ".saved";
+    FileSaver saver;
+    double startTime = timeEdit([&] { saver.start(document, outputName); });
+    saver.wait();
+    SaveResult saved;
+    saver.poll(saved);
+    double savedMegabytes = saved.bytes / (1024.0 * 1024.0);
+    cout << "save: " << savedMegabytes << " MB in " << saved.seconds * 1000 << " ms (" << savedMegabytes / saved.seconds
+         << " MB/s, fsync included), editor blocked " << startTime / 1000 << " ms" << (saved.success ? "" : ", FAILED: " + saved.error) << "\n";
+    remove(outputName.c_str());
+
+    // Closing drops every piece of the edited document at once
+    size_t pieces = document.pieceCount();
+    double closeTime = timeEdit([&] { document.load(string()); });
+    cout << "close: " << pieces << " pieces freed in " << closeTime / 1000 << " ms\n";
+
+    remove(inputName);
+    return 0;
+}
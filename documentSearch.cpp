@@ -0,0 +1,471 @@
+#include    "documentSearch.h" // Include the header file for the document search
+#include    "textScan.h"       // For the vectorized pattern search
+#include    <algorithm>        // For lower_bound and min
+#include    <iterator>         // For make_move_iterator
+#include    <cstring>          // For memcmp
+#include    <cstdint>          // For SIZE_MAX
+using namespace std; // Use the standard namespace for convenience
+
+// Results bigger than this are not kept for a shorter pattern, they are cheaper to scan again
+const size_t MAX_SAVED_MATCHES = 1 << 20;
+// Narrowing checks every previous match in the tree; past one match every 512 characters a new scan is faster
+const size_t NARROW_DENSITY = 512;
+
+// Offsets in a new block; a block is cut in blocks of this size once it holds twice as many
+const size_t MATCH_BLOCK = 1024;
+
+// Constructor to create an empty list
+MatchList::MatchList() : shiftTree(1, 0), countTree(1, 0), total(0) {}
+
+// Function to get the number of offsets
+size_t MatchList::size() const {
+    return total;
+}
+
+// Function to get the shift owed by a block: the sum of the shifts up to it
+size_t MatchList::shiftOf(size_t block) const {
+    size_t sum = 0;
+    for (size_t i = block + 1; i > 0; i -= i & (~i + 1)) {
+        sum += shiftTree[i];
+    }
+    return sum;
+}
+
+// Function to get the number of offsets in the blocks before a block
+size_t MatchList::countBefore(size_t block) const {
+    size_t sum = 0;
+    for (size_t i = block; i > 0; i -= i & (~i + 1)) {
+        sum += countTree[i];
+    }
+    return sum;
+}
+
+// Function to find the last block whose first offset is at most offset
+// The shifts keep the blocks in order, so a binary search on their first offset finds it.
+size_t MatchList::locate(size_t offset) const {
+    size_t low = 0, high = blocks.size();
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        if (blocks[middle].front() + shiftOf(middle) <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Function to find the first offset of a block that is at least offset
+vector<size_t>::const_iterator MatchList::lowerBound(size_t block, size_t offset) const {
+    size_t shift = shiftOf(block);
+    return lower_bound(blocks[block].begin(), blocks[block].end(), offset,
+                       [shift](size_t stored, size_t value) { return stored + shift < value; });
+}
+
+// Function to get an offset by its rank: walk down the Fenwick tree of the block sizes
+size_t MatchList::at(size_t index) const {
+    size_t block = 0;
+    size_t step = 1;
+    while (step * 2 <= blocks.size()) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (block + step <= blocks.size() && countTree[block + step] <= index) {
+            block += step;
+            index -= countTree[block];
+        }
+    }
+    return blocks[block][index] + shiftOf(block);
+}
+
+// Function to get the number of offsets below an offset
+size_t MatchList::rank(size_t offset) const {
+    if (blocks.empty()) {
+        return 0;
+    }
+    size_t block = locate(offset);
+    return countBefore(block) + (lowerBound(block, offset) - blocks[block].begin());
+}
+
+// Function to replace every offset with a sorted list
+void MatchList::assign(const vector<size_t>& offsets) {
+    clear();
+    for (size_t start = 0; start < offsets.size(); start += MATCH_BLOCK) {
+        blocks.emplace_back(offsets.begin() + start, offsets.begin() + min(offsets.size(), start + MATCH_BLOCK));
+        shifts.push_back(0);
+    }
+    total = offsets.size();
+    rebuild();
+}
+
+// Function to copy every offset out in order
+void MatchList::copyTo(vector<size_t>& out) const {
+    out.clear();
+    out.reserve(total);
+    for (size_t block = 0; block < blocks.size(); block++) {
+        size_t shift = shiftOf(block);
+        for (size_t stored : blocks[block]) {
+            out.push_back(stored + shift);
+        }
+    }
+}
+
+// Function to remove every offset
+void MatchList::clear() {
+    blocks.clear();
+    shifts.clear();
+    shiftTree.assign(1, 0);
+    countTree.assign(1, 0);
+    total = 0;
+}
+
+// Function to remove the offsets inside [from, to)
+void MatchList::erase(size_t from, size_t to) {
+    if (blocks.empty() || from >= to) {
+        return;
+    }
+    bool emptied = false;
+    for (size_t block = locate(from); block < blocks.size(); block++) {
+        vector<size_t>& offsets = blocks[block];
+        if (offsets.front() + shiftOf(block) >= to) {
+            break;  // This block and the next ones start after the range
+        }
+        auto first = lowerBound(block, from) - offsets.begin();
+        auto last = lowerBound(block, to) - offsets.begin();
+        offsets.erase(offsets.begin() + first, offsets.begin() + last);
+        total -= last - first;
+        for (size_t i = block + 1; i <= blocks.size(); i += i & (~i + 1)) {
+            countTree[i] -= last - first;
+        }
+        emptied |= offsets.empty();
+    }
+    if (!emptied) {
+        return;
+    }
+    // An empty block hands its shift to the next block, so the offsets after it do not move
+    size_t kept = 0;
+    for (size_t block = 0; block < blocks.size(); block++) {
+        if (blocks[block].empty()) {
+            if (block + 1 < blocks.size()) {
+                shifts[block + 1] += shifts[block];
+            }
+            continue;
+        }
+        blocks[kept].swap(blocks[block]);
+        shifts[kept++] = shifts[block];
+    }
+    blocks.resize(kept);
+    shifts.resize(kept);
+    rebuild();
+}
+
+// Function to add delta to every offset at or after offset
+// Only the block the offset falls in is rewritten; the blocks after it get the delta through one shift.
+void MatchList::shift(size_t offset, ptrdiff_t delta) {
+    if (blocks.empty() || delta == 0) {
+        return;
+    }
+    size_t block = locate(offset);
+    size_t change = static_cast<size_t>(delta);  // Wraps around, so adding it subtracts when delta is negative
+    vector<size_t>& offsets = blocks[block];
+    for (auto stored = offsets.begin() + (lowerBound(block, offset) - offsets.begin()); stored != offsets.end(); ++stored) {
+        *stored += change;
+    }
+    if (block + 1 < blocks.size()) {
+        shifts[block + 1] += change;
+        for (size_t i = block + 2; i <= blocks.size(); i += i & (~i + 1)) {
+            shiftTree[i] += change;
+        }
+    }
+}
+
+// Function to add sorted offsets that all fall between the same two offsets of the list
+void MatchList::insert(const vector<size_t>& offsets) {
+    if (offsets.empty()) {
+        return;
+    }
+    if (blocks.empty()) {
+        assign(offsets);
+        return;
+    }
+    size_t block = locate(offsets.front());
+    size_t shift = shiftOf(block);
+    vector<size_t>& stored = blocks[block];
+    size_t index = lowerBound(block, offsets.front()) - stored.begin();
+    stored.insert(stored.begin() + index, offsets.size(), 0);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        stored[index + i] = offsets[i] - shift;
+    }
+    total += offsets.size();
+    if (stored.size() < 2 * MATCH_BLOCK) {
+        for (size_t i = block + 1; i <= blocks.size(); i += i & (~i + 1)) {
+            countTree[i] += offsets.size();
+        }
+        return;
+    }
+
+    // Cut a block that grew too big; the new blocks owe the same shift, so their own shift is 0
+    vector<size_t> grown;
+    grown.swap(stored);
+    vector<vector<size_t>> pieces;
+    for (size_t start = 0; start < grown.size(); start += MATCH_BLOCK) {
+        pieces.emplace_back(grown.begin() + start, grown.begin() + min(grown.size(), start + MATCH_BLOCK));
+    }
+    blocks[block].swap(pieces.front());
+    blocks.insert(blocks.begin() + block + 1, make_move_iterator(pieces.begin() + 1), make_move_iterator(pieces.end()));
+    shifts.insert(shifts.begin() + block + 1, pieces.size() - 1, 0);
+    rebuild();
+}
+
+// Function to build both Fenwick trees in linear time
+void MatchList::rebuild() {
+    shiftTree.assign(blocks.size() + 1, 0);
+    countTree.assign(blocks.size() + 1, 0);
+    for (size_t i = 1; i <= blocks.size(); i++) {
+        shiftTree[i] += shifts[i - 1];
+        countTree[i] += blocks[i - 1].size();
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= blocks.size()) {
+            shiftTree[parent] += shiftTree[i];
+            countTree[parent] += countTree[i];
+        }
+    }
+}
+
+// Constructor to create a search without a pattern
+DocumentSearch::DocumentSearch() : complete(true) {}
+
+// Function to search for a pattern
+void DocumentSearch::setPattern(const PieceTable& document, const string& newPattern) {
+    if (newPattern == pattern) {
+        return;
+    }
+    if (newPattern.empty()) {
+        clear();
+        return;
+    }
+
+    // Only the saved results of patterns the new one starts with are still useful
+    while (!history.empty() && newPattern.compare(0, history.back().pattern.size(), history.back().pattern) != 0) {
+        history.pop_back();
+    }
+    bool extends = complete && !pattern.empty() && newPattern.size() > pattern.size()
+                   && newPattern.compare(0, pattern.size(), pattern) == 0;
+
+    // Erasing the end of the pattern goes back to the results of the longest saved prefix
+    if (!extends && !history.empty()) {
+        pattern = history.back().pattern;
+        swap(matches, history.back().matches);
+        complete = true;
+        history.pop_back();
+        if (pattern == newPattern) {
+            return;
+        }
+        extends = true;
+    }
+
+    // Keep the results of the shorter pattern for when it is erased back to it
+    if (extends && matches.size() <= MAX_SAVED_MATCHES) {
+        history.push_back(SavedResult{pattern, matches});
+    }
+    pattern = newPattern;
+
+    // Every occurrence of the new pattern is an occurrence of the shorter one, so checking those is enough
+    vector<size_t> found;
+    if (extends && matches.size() < document.length() / NARROW_DENSITY) {
+        matches.copyTo(found);
+        size_t kept = 0;
+        for (size_t match : found) {
+            if (matchesAt(document, match)) {
+                found[kept++] = match;
+            }
+        }
+        found.resize(kept);
+        matches.assign(found);
+        return;
+    }
+
+    // Otherwise scan the whole document
+    scan(document, 0, document.length(), found);
+    matches.assign(found);
+    complete = found.size() < MAX_MATCHES;
+}
+
+// Function to forget the pattern and every match
+void DocumentSearch::clear() {
+    pattern.clear();
+    matches.clear();
+    history.clear();
+    complete = true;
+}
+
+// Function to get the current pattern
+const string& DocumentSearch::getPattern() const {
+    return pattern;
+}
+
+// Function to get the start offsets of every match
+const MatchList& DocumentSearch::getMatches() const {
+    return matches;
+}
+
+// Function to know whether every match was kept
+bool DocumentSearch::isComplete() const {
+    return complete;
+}
+
+// Function to find the first match at or after offset, wrapping around to the first match
+bool DocumentSearch::next(size_t offset, size_t& match) const {
+    if (matches.size() == 0) {
+        return false;
+    }
+    size_t found = matches.rank(offset);
+    match = matches.at(found < matches.size() ? found : 0);
+    return true;
+}
+
+// Function to find the last match before offset, wrapping around to the last match
+bool DocumentSearch::previous(size_t offset, size_t& match) const {
+    if (matches.size() == 0) {
+        return false;
+    }
+    size_t found = matches.rank(offset);
+    match = matches.at((found > 0 ? found : matches.size()) - 1);
+    return true;
+}
+
+// Function to update the matches after count characters were inserted at offset
+void DocumentSearch::onInsert(const PieceTable& document, size_t offset, size_t count) {
+    if (pattern.empty() || count == 0) {
+        return;
+    }
+    history.clear();  // The saved offsets are not shifted, they would be wrong now
+
+    // Matches that started in the pattern length before the insertion point are cut by the new text
+    size_t from = offset >= pattern.size() - 1 ? offset - (pattern.size() - 1) : 0;
+    matches.erase(from, offset);
+    // The matches after the insertion point move with their text
+    matches.shift(offset, static_cast<ptrdiff_t>(count));
+    // New matches can only start between the cut ones and the end of the inserted text
+    rescan(document, from, offset + count);
+}
+
+// Function to update the matches after count characters were erased at offset
+void DocumentSearch::onErase(const PieceTable& document, size_t offset, size_t count) {
+    if (pattern.empty() || count == 0) {
+        return;
+    }
+    history.clear();
+
+    // Matches that overlapped the erased text are gone
+    size_t from = offset >= pattern.size() - 1 ? offset - (pattern.size() - 1) : 0;
+    matches.erase(from, offset + count);
+    matches.shift(offset + count, -static_cast<ptrdiff_t>(count));
+    // The text joined at the erase point may form new matches
+    rescan(document, from, offset);
+}
+
+// Function to search the whole document again
+void DocumentSearch::refresh(const PieceTable& document) {
+    string current = pattern;
+    clear();
+    setPattern(document, current);
+}
+
+// Function to list the matches that do not overlap the previous one
+void DocumentSearch::nonOverlapping(const PieceTable& document, vector<size_t>& out) const {
+    out.clear();
+    if (pattern.empty()) {
+        return;
+    }
+    if (complete) {
+        matches.copyTo(out);  // Already up to date with the document
+    } else {
+        scan(document, 0, document.length(), out, SIZE_MAX);
+    }
+    // Keep a match only when it starts after the end of the last kept one ("aa" in "aaa" is replaced once)
+    size_t kept = 0;
+    for (size_t match : out) {
+        if (kept == 0 || match >= out[kept - 1] + pattern.size()) {
+            out[kept++] = match;
+        }
+    }
+    out.resize(kept);
+}
+
+// Function to append the matches that start inside [from, to) to out
+void DocumentSearch::scan(const PieceTable& document, size_t from, size_t to, vector<size_t>& out, size_t limit) const {
+    size_t length = pattern.size();
+    size_t end = min(document.length(), to + length - 1);  // A match starting before to may end after it
+    if (length == 0 || from >= end || end - from < length) {
+        return;
+    }
+
+    string carry;          // Last length - 1 characters of the spans visited so far
+    size_t position = from; // Document offset of the current span
+    bool full = false;
+    document.forEachSpan(from, end - from, [&](const char* data, size_t size) {
+        if (full) {
+            return;
+        }
+        // Matches that start in the previous spans and end in this one
+        if (!carry.empty()) {
+            string joined = carry;
+            joined.append(data, min(size, length - 1));
+            size_t carryStart = position - carry.size();
+            for (size_t i = 0; i < carry.size() && i + length <= joined.size() && carryStart + i < to; i++) {
+                if (i + length > carry.size() && joined.compare(i, length, pattern) == 0) {
+                    out.push_back(carryStart + i);
+                }
+            }
+        }
+        // Matches inside this span, found with the vectorized search
+        const char* cursor = data;
+        const char* spanEnd = data + size;
+        while ((cursor = TextScan::find(cursor, spanEnd - cursor, pattern.data(), length)) != nullptr) {
+            size_t start = position + (cursor - data);
+            if (start >= to) {
+                break;
+            }
+            if (out.size() >= limit) {
+                full = true;
+                return;
+            }
+            out.push_back(start);
+            cursor++;
+        }
+        // Keep the end of the span for the matches that continue in the next one
+        if (size >= length - 1) {
+            carry.assign(spanEnd - (length - 1), length - 1);
+        } else {
+            carry.append(data, size);
+            if (carry.size() > length - 1) {
+                carry.erase(0, carry.size() - (length - 1));
+            }
+        }
+        position += size;
+    });
+}
+
+// Function to know whether the pattern occurs at an offset of the document
+bool DocumentSearch::matchesAt(const PieceTable& document, size_t offset) const {
+    if (offset + pattern.size() > document.length()) {
+        return false;
+    }
+    size_t compared = 0;
+    bool equal = true;
+    document.forEachSpan(offset, pattern.size(), [&](const char* data, size_t size) {
+        if (equal && memcmp(data, pattern.data() + compared, size) != 0) {
+            equal = false;
+        }
+        compared += size;
+    });
+    return equal;
+}
+
+// Function to scan the region around an edit and put its matches in place
+void DocumentSearch::rescan(const PieceTable& document, size_t from, size_t to) {
+    vector<size_t> found;
+    scan(document, from, to, found);
+    matches.insert(found);
+}
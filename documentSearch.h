@@ -0,0 +1,111 @@
+#ifndef DOCUMENTSEARCH_H
+#define DOCUMENTSEARCH_H
+
+#include <string>
+#include <vector>   // For the sorted match offsets
+#include <cstddef>  // For size_t and ptrdiff_t
+#include "pieceTable.h" // For the document that is searched
+
+// MatchList class to keep the sorted start offsets of the matches while the document is edited
+// The offsets are stored in blocks of about a thousand, and every block owes a shift to the offsets it holds.
+// The shifts and the block sizes are summed with Fenwick trees, so an edit moves every match after it by
+// changing one shift in O(log n) and only rewrites the offsets of the block it falls in.
+class MatchList {
+public:
+    // Constructor to create an empty list
+    MatchList();
+
+    // Method to get the number of offsets
+    size_t size() const;
+    // Method to get an offset by its rank in the sorted list
+    size_t at(size_t index) const;
+    // Method to get the number of offsets below an offset (the rank of the first offset at or after it)
+    size_t rank(size_t offset) const;
+    // Method to replace every offset with a sorted list, and to copy them out in order
+    void assign(const std::vector<size_t>& offsets);
+    void copyTo(std::vector<size_t>& out) const;
+    // Method to remove every offset
+    void clear();
+    // Method to remove the offsets inside [from, to)
+    void erase(size_t from, size_t to);
+    // Method to add delta to every offset at or after offset
+    void shift(size_t offset, ptrdiff_t delta);
+    // Method to add sorted offsets that all fall between the same two offsets of the list
+    void insert(const std::vector<size_t>& offsets);
+
+private:
+    std::vector<std::vector<size_t>> blocks; // Offsets of every block, without their shift, never empty
+    std::vector<size_t> shifts;              // Shift added to this block and every block after it (wraps to subtract)
+    std::vector<size_t> shiftTree;           // Fenwick tree of shifts
+    std::vector<size_t> countTree;           // Fenwick tree of the block sizes
+    size_t total;                            // Number of offsets
+
+    // Helpers to get the shift owed by a block and the number of offsets in the blocks before it
+    size_t shiftOf(size_t block) const;
+    size_t countBefore(size_t block) const;
+    // Helper to find the last block whose first offset is at most offset (the first block when there is none)
+    size_t locate(size_t offset) const;
+    // Helper to find the first offset of a block that is at least offset
+    std::vector<size_t>::const_iterator lowerBound(size_t block, size_t offset) const;
+    // Helper to build both Fenwick trees again after blocks were added or removed
+    void rebuild();
+};
+
+// DocumentSearch class to find every occurrence of a literal pattern in the document
+// The pieces are scanned with the vectorized TextScan::find, so a full search runs at memory bandwidth.
+// Typing one more character of the pattern only re-checks the previous matches (an occurrence of the longer
+// pattern is always an occurrence of the shorter one), and erasing it restores the results kept for the
+// shorter pattern. Edits of the document shift the matches after them and rescan only the edited region;
+// the matches are kept in a MatchList, so the shift does not touch every match after the edit.
+class DocumentSearch {
+public:
+    // Constructor to create a search without a pattern
+    DocumentSearch();
+
+    // Method to search for a pattern, narrowing or restoring the previous results when possible
+    void setPattern(const PieceTable& document, const std::string& pattern);
+    // Method to forget the pattern and every match
+    void clear();
+    // Method to get the current pattern
+    const std::string& getPattern() const;
+
+    // Method to get the start offsets of every match, sorted (matches may overlap)
+    const MatchList& getMatches() const;
+    // Method to know whether every match was kept (false when there were more than MAX_MATCHES)
+    bool isComplete() const;
+    // Methods to find the first match after offset and the last match before offset, wrapping around
+    // They return false when there is no match.
+    bool next(size_t offset, size_t& match) const;
+    bool previous(size_t offset, size_t& match) const;
+
+    // Methods to keep the matches up to date; call them after the document was changed
+    void onInsert(const PieceTable& document, size_t offset, size_t count);
+    void onErase(const PieceTable& document, size_t offset, size_t count);
+    // Method to search the whole document again (after a change too large to follow, like a replace-all)
+    void refresh(const PieceTable& document);
+    // Method to list every match that does not overlap the previous one, without the MAX_MATCHES limit
+    void nonOverlapping(const PieceTable& document, std::vector<size_t>& out) const;
+
+    static const size_t MAX_MATCHES = 1 << 22; // Matches kept at most (32 MB of offsets)
+
+private:
+    // Results kept for a shorter pattern, restored when the pattern is erased back to it
+    struct SavedResult {
+        std::string pattern;
+        MatchList matches;
+    };
+
+    std::string pattern;              // Pattern searched for
+    MatchList matches;                // Start offset of every match, sorted
+    bool complete;                    // False when the matches were cut at MAX_MATCHES
+    std::vector<SavedResult> history; // Results of the shorter patterns typed before this one
+
+    // Helper to append the matches that start inside [from, to) to out, stopping when out holds limit matches
+    void scan(const PieceTable& document, size_t from, size_t to, std::vector<size_t>& out, size_t limit = MAX_MATCHES) const;
+    // Helper to know whether the pattern occurs at an offset of the document
+    bool matchesAt(const PieceTable& document, size_t offset) const;
+    // Helper to rescan the region around an edit and put its matches in place
+    void rescan(const PieceTable& document, size_t from, size_t to);
+};
+
+#endif // DOCUMENTSEARCH_H
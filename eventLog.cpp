@@ -0,0 +1,110 @@
+#include    "eventLog.h" // Include the header file for the session recorder
+#include    <sstream>    // For parsing one step per line
+using namespace std; // Use the standard namespace for convenience
+
+// Function to start recording into a file
+bool EventLog::openForWriting(const string& filename) {
+    output.open(filename, ios::trunc);
+    return output.is_open();
+}
+
+// Function to know whether a session is being recorded
+bool EventLog::isRecording() const {
+    return output.is_open();
+}
+
+// Function to write one event of the session
+void EventLog::record(const sf::Event& event) {
+    if (!output.is_open()) {
+        return;
+    }
+    if (event.type == sf::Event::TextEntered) {
+        output << "T " << event.text.unicode << '\n';
+    } else if (event.type == sf::Event::KeyPressed) {
+        output << "K " << event.key.code << ' ' << event.key.control << ' ' << event.key.shift << ' ' << event.key.alt << '\n';
+    } else if (event.type == sf::Event::KeyReleased) {
+        // Released keys are kept for Shift, which turns the wheel sideways
+        output << "R " << event.key.code << ' ' << event.key.control << ' ' << event.key.shift << ' ' << event.key.alt << '\n';
+    } else if (event.type == sf::Event::MouseWheelScrolled) {
+        output << "W " << event.mouseWheelScroll.delta << ' ' << event.mouseWheelScroll.wheel << '\n';
+    }
+}
+
+// Function to write a file opened or saved
+void EventLog::recordFile(ReplayStep::Kind kind, const string& filename) {
+    if (output.is_open() && kind != ReplayStep::EVENT) {
+        output << (kind == ReplayStep::OPEN ? "O " : "S ") << filename << '\n';
+    }
+}
+
+// Function to write a paste, escaped to stay on one line
+void EventLog::recordPaste(const string& text) {
+    if (!output.is_open()) {
+        return;
+    }
+    output << "P ";
+    for (char ch : text) {
+        if (ch == '\n') {
+            output << "\\n";
+        } else if (ch == '\r') {
+            output << "\\r";
+        } else if (ch == '\\') {
+            output << "\\\\";
+        } else {
+            output << ch;
+        }
+    }
+    output << '\n';
+}
+
+// Function to read every step of a recorded session
+bool EventLog::load(const string& filename, vector<ReplayStep>& steps) {
+    ifstream input(filename);
+    if (!input) {
+        return false;
+    }
+
+    string line;
+    while (getline(input, line)) {
+        if (line.size() < 2) {
+            continue;  // Skip empty lines
+        }
+        ReplayStep step;
+        step.kind = ReplayStep::EVENT;
+        step.event = sf::Event();
+        istringstream fields(line.substr(2));
+
+        if (line[0] == 'T') {
+            step.event.type = sf::Event::TextEntered;
+            fields >> step.event.text.unicode;
+        } else if (line[0] == 'K' || line[0] == 'R') {
+            int code = 0;
+            fields >> code >> step.event.key.control >> step.event.key.shift >> step.event.key.alt;
+            step.event.type = line[0] == 'K' ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+            step.event.key.code = static_cast<sf::Keyboard::Key>(code);
+        } else if (line[0] == 'W') {
+            int wheel = sf::Mouse::VerticalWheel;  // Sessions recorded before the wheel was logged only scroll lines
+            step.event.type = sf::Event::MouseWheelScrolled;
+            fields >> step.event.mouseWheelScroll.delta >> wheel;
+            step.event.mouseWheelScroll.wheel = static_cast<sf::Mouse::Wheel>(wheel);
+        } else if (line[0] == 'O' || line[0] == 'S') {
+            step.kind = line[0] == 'O' ? ReplayStep::OPEN : ReplayStep::SAVE;
+            step.filename = line.substr(2);
+        } else if (line[0] == 'P') {
+            step.kind = ReplayStep::PASTE;
+            step.text.reserve(line.size() - 2);
+            for (size_t i = 2; i < line.size(); i++) {
+                if (line[i] == '\\' && i + 1 < line.size()) {
+                    i++;
+                    step.text += line[i] == 'n' ? '\n' : line[i] == 'r' ? '\r' : line[i];
+                } else {
+                    step.text += line[i];
+                }
+            }
+        } else {
+            continue;  // Unknown step
+        }
+        steps.push_back(step);
+    }
+    return true;
+}
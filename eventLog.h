@@ -0,0 +1,42 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <SFML/Window.hpp>  // Include for sf::Event
+#include <fstream>          // For the log file
+#include <string>
+#include <vector>
+
+// ReplayStep struct to store one step of a recorded editing session
+struct ReplayStep {
+    enum Kind { EVENT, OPEN, SAVE, PASTE } kind; // Input event, file opened from the popup, file saved, or clipboard pasted
+    sf::Event event;                      // Event given to TextEditor::handleInput (EVENT only)
+    std::string filename;                 // File opened or saved (OPEN and SAVE only)
+    std::string text;                     // Pasted text (PASTE only)
+};
+
+// EventLog class to record the input of an editing session in a text file and read it back
+// Every step is one line: "T <unicode>" text entered, "K <key> <control> <shift> <alt>" key pressed,
+// "R <key> <control> <shift> <alt>" key released, "W <delta> <wheel>" mouse wheel, "O <file>" file opened, "S <file>" file saved and "P <text>" clipboard pasted
+// (with \n, \r and \\ escaped, so the paste stays on one line). The replay benchmark feeds the steps
+// back into a TextEditor without a window.
+class EventLog {
+public:
+    // Method to start recording into a file (it is replaced)
+    bool openForWriting(const std::string& filename);
+    // Method to know whether a session is being recorded
+    bool isRecording() const;
+    // Method to record an event, only the events that change the editor are written
+    void record(const sf::Event& event);
+    // Method to record a file opened or saved outside handleInput
+    void recordFile(ReplayStep::Kind kind, const std::string& filename);
+    // Method to record the text of a paste (the clipboard is not there when the session is replayed)
+    void recordPaste(const std::string& text);
+
+    // Method to read every step of a recorded session
+    static bool load(const std::string& filename, std::vector<ReplayStep>& steps);
+
+private:
+    std::ofstream output; // File the session is written to
+};
+
+#endif // EVENTLOG_H
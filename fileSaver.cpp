@@ -0,0 +1,224 @@
+#include    "fileSaver.h" // Include the header file for the background save
+#include    <algorithm>   // For min
+#include    <chrono>      // For the duration of the save
+#include    <cstdio>      // For rename and remove
+#include    <vector>      // For the batches of spans
+#ifdef _WIN32
+#define     NOMINMAX      // Keep std::min usable
+#include    <windows.h>   // For CreateFile, FlushFileBuffers and MoveFileEx
+#else
+#include    <cerrno>      // For errno
+#include    <cstring>     // For strerror
+#include    <fcntl.h>     // For open
+#include    <sys/stat.h>  // For the permissions of the target
+#include    <sys/uio.h>   // For writev
+#include    <unistd.h>    // For fsync and close
+#endif
+using namespace std; // Use the standard namespace for convenience
+
+#ifdef _WIN32
+// Size of the buffer the spans are gathered in before a write
+const size_t WRITE_BUFFER = 1 << 20;
+#else
+// Spans handed to one writev call (the usual IOV_MAX)
+const size_t WRITE_SPANS = 1024;
+#endif
+
+// Constructor to create a saver with no save running
+FileSaver::FileSaver() : result(), unreported(false), finished(true), writtenBytes(0) {}
+
+// Destructor to wait for the running save
+FileSaver::~FileSaver() {
+    wait();
+}
+
+// Function to start saving a snapshot of the document on the worker
+bool FileSaver::start(const PieceTable& document, const string& newFilename) {
+    if (isSaving()) {
+        return false;
+    }
+    wait();  // Joins the thread of the previous save
+    filename = newFilename;
+    unreported = true;
+    document.snapshot(text);
+    writtenBytes.store(0);
+    finished.store(false);
+    worker = thread(&FileSaver::saveSnapshot, this);
+    return true;
+}
+
+// Function to know whether a save is running
+bool FileSaver::isSaving() const {
+    return worker.joinable() && !finished.load();
+}
+
+// Function to get the fraction of the document written so far
+float FileSaver::progress() const {
+    return text.length == 0 ? 1.f : static_cast<float>(writtenBytes.load()) / (text.length + 1);
+}
+
+// Function to hand over the result of a finished save, once
+bool FileSaver::poll(SaveResult& finishedResult) {
+    if (!unreported || isSaving()) {
+        return false;
+    }
+    wait();
+    unreported = false;
+    text = TextSnapshot();  // Release the buffers the snapshot shares
+    finishedResult = result;
+    return true;
+}
+
+// Function to wait until the running save is over
+void FileSaver::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+// Function run by the worker to write the snapshot next to the target and move it over the target
+void FileSaver::saveSnapshot() {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string temporaryName = filename + ".tmp";
+    string error = writeTemporary(temporaryName);
+
+    if (error.empty()) {
+#ifdef _WIN32
+        // Replaces the target in one step; WRITE_THROUGH returns once the move is on disk
+        if (!MoveFileExA(temporaryName.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            error = "cannot replace the file";
+        }
+#else
+        if (rename(temporaryName.c_str(), filename.c_str()) != 0) {
+            error = string("cannot replace the file: ") + strerror(errno);
+        } else {
+            // The rename is only durable once the directory that holds the file is flushed too
+            size_t slash = filename.find_last_of('/');
+            string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+            int directoryFile = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+            if (directoryFile >= 0) {
+                fsync(directoryFile);
+                ::close(directoryFile);
+            }
+        }
+#endif
+    }
+    if (!error.empty()) {
+        remove(temporaryName.c_str());
+    }
+
+    result.success = error.empty();
+    result.filename = filename;
+    result.error = error;
+    result.bytes = writtenBytes.load();
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    finished.store(true);
+}
+
+#ifdef _WIN32
+// Function to write the snapshot to a temporary file, gathering the spans into large writes
+string FileSaver::writeTemporary(const string& temporaryName) {
+    HANDLE file = CreateFileA(temporaryName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return "cannot create " + temporaryName;
+    }
+    vector<char> buffer;
+    buffer.reserve(WRITE_BUFFER);
+    bool failed = false;
+
+    // Writes the gathered characters
+    auto flush = [&]() {
+        size_t done = 0;
+        while (!failed && done < buffer.size()) {
+            DWORD written = 0;
+            DWORD chunk = static_cast<DWORD>(buffer.size() - done);
+            failed = !WriteFile(file, buffer.data() + done, chunk, &written, nullptr);
+            done += written;
+        }
+        writtenBytes.fetch_add(buffer.size(), memory_order_relaxed);
+        buffer.clear();
+    };
+
+    for (const auto& span : text.spans) {
+        const char* data = span.first;
+        size_t size = span.second;
+        while (size > 0 && !failed) {
+            size_t take = min(size, WRITE_BUFFER - buffer.size());
+            buffer.insert(buffer.end(), data, data + take);
+            data += take;
+            size -= take;
+            if (buffer.size() == WRITE_BUFFER) {
+                flush();
+            }
+        }
+    }
+    buffer.push_back('\n');  // Every line, including the last one, is followed by a newline character
+    flush();
+
+    failed = !FlushFileBuffers(file) || failed;
+    CloseHandle(file);
+    return failed ? "cannot write " + temporaryName : "";
+}
+#else
+// Function to write the snapshot to a temporary file with vectored writes straight from the spans
+string FileSaver::writeTemporary(const string& temporaryName) {
+    // The new file keeps the permissions of the file it replaces
+    struct stat target;
+    mode_t mode = stat(filename.c_str(), &target) == 0 ? (target.st_mode & 07777) : 0644;
+    int file = ::open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (file < 0) {
+        return "cannot create " + temporaryName + ": " + strerror(errno);
+    }
+
+    vector<iovec> batch;
+    batch.reserve(WRITE_SPANS);
+    string error;
+
+    // Writes the spans of the batch; writev may write less than asked, so it goes on where it stopped
+    auto flush = [&]() {
+        size_t index = 0;
+        while (error.empty() && index < batch.size()) {
+            ssize_t written = writev(file, batch.data() + index, static_cast<int>(batch.size() - index));
+            if (written < 0) {
+                if (errno != EINTR) {
+                    error = "cannot write " + temporaryName + ": " + strerror(errno);
+                }
+                continue;
+            }
+            writtenBytes.fetch_add(written, memory_order_relaxed);
+            size_t left = static_cast<size_t>(written);
+            while (left > 0 && left >= batch[index].iov_len) {
+                left -= batch[index].iov_len;
+                index++;
+            }
+            if (left > 0) {
+                batch[index].iov_base = static_cast<char*>(batch[index].iov_base) + left;
+                batch[index].iov_len -= left;
+            }
+        }
+        batch.clear();
+    };
+
+    for (const auto& span : text.spans) {
+        if (span.second == 0) {
+            continue;  // An empty span would make writev return 0 forever
+        }
+        batch.push_back(iovec{const_cast<char*>(span.first), span.second});
+        if (batch.size() == WRITE_SPANS) {
+            flush();
+        }
+    }
+    char lineFeed = '\n';  // Every line, including the last one, is followed by a newline character
+    batch.push_back(iovec{&lineFeed, 1});
+    flush();
+
+    // The data must be on disk before the rename makes it the target
+    if (error.empty() && fsync(file) != 0) {
+        error = "cannot flush " + temporaryName + ": " + strerror(errno);
+    }
+    if (::close(file) != 0 && error.empty()) {
+        error = "cannot close " + temporaryName + ": " + strerror(errno);
+    }
+    return error;
+}
+#endif
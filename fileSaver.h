@@ -0,0 +1,62 @@
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+#include <string>
+#include <cstddef>  // For size_t
+#include <atomic>   // For the progress shared with the save thread
+#include <thread>   // For saving in the background
+#include "pieceTable.h" // For the snapshot that is written
+
+// SaveResult struct to describe a finished save
+struct SaveResult {
+    bool success;          // True when the file was written, flushed to disk and renamed over the target
+    std::string filename;  // File that was saved
+    std::string error;     // What failed (empty on success)
+    size_t bytes;          // Number of bytes written
+    double seconds;        // Time from the start of the save to the rename
+};
+
+// FileSaver class to write a document to disk on a worker thread
+// The worker writes a snapshot of the document, so typing continues while a large file is saved.
+// The spans of the snapshot go to the disk with vectored writes (no copy into a buffer), into a
+// temporary file next to the target that is flushed to disk and then renamed over the target, so a
+// crash during the save leaves either the old file or the new one, never a truncated one.
+class FileSaver {
+public:
+    // Constructor to create a saver with no save running
+    FileSaver();
+    // Destructor to wait for the running save
+    ~FileSaver();
+
+    // The save thread works on this object, so it cannot be copied
+    FileSaver(const FileSaver&) = delete;
+    FileSaver& operator=(const FileSaver&) = delete;
+
+    // Method to start saving a snapshot of the document, returns false when a save is already running
+    // Every line, including the last one, is followed by a '\n' in the file.
+    bool start(const PieceTable& document, const std::string& filename);
+    // Method to know whether a save is running
+    bool isSaving() const;
+    // Method to get the fraction of the document written so far (0 to 1)
+    float progress() const;
+    // Method to get the result of a save once it is over; returns true once per finished save (call it once per frame)
+    bool poll(SaveResult& result);
+    // Method to wait until the running save is over (its result is still returned by poll)
+    void wait();
+
+private:
+    TextSnapshot text;               // Version of the document being written
+    std::string filename;            // File being saved
+    SaveResult result;               // Result of the last save, written by the worker before it finishes
+    bool unreported;                 // True from the start of a save until poll has returned its result
+    std::thread worker;              // Thread writing the snapshot
+    std::atomic<bool> finished;      // Set by the worker when the result is ready
+    std::atomic<size_t> writtenBytes; // Bytes written so far
+
+    // Helper run by the worker to write the snapshot and replace the target
+    void saveSnapshot();
+    // Helper to write every span of the snapshot and the final '\n' to a temporary file, returns an error or ""
+    std::string writeTemporary(const std::string& temporaryName);
+};
+
+#endif // FILESAVER_H
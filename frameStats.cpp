@@ -0,0 +1,148 @@
+#include    "frameStats.h" // Include the header file for the frame counters
+#include    <algorithm>    // For nth_element and max
+#include    <fstream>      // For exporting the history
+#include    <sstream>      // For building the overlay text
+#include    <vector>
+using namespace std; // Use the standard namespace for convenience
+
+// Constructor to create an empty history
+FrameStats::FrameStats(size_t historySize) : maxHistory(historySize), droppedFrames(0), overlayVisible(false), bars(sf::Triangles) {}
+
+// Function to add the counters of a frame
+void FrameStats::addFrame(const FrameSample& sample) {
+    history.push_back(sample);
+    if (history.size() > maxHistory) {
+        history.pop_front();
+        droppedFrames++;
+    }
+}
+
+// Function to show or hide the overlay
+void FrameStats::toggleOverlay() {
+    overlayVisible = !overlayVisible;
+}
+
+// Function to know whether the overlay is drawn
+bool FrameStats::isOverlayVisible() const {
+    return overlayVisible;
+}
+
+// Function to draw the overlay
+void FrameStats::render(sf::RenderWindow& window, const sf::Font& font) {
+    if (!overlayVisible || history.empty()) {
+        return;
+    }
+    const FrameSample& last = history.back();
+    const float width = 260.f;
+    const float histogramHeight = 60.f;
+    float left = window.getSize().x - width - 10.f;
+    float top = 60.f;
+
+    // Counters of the latest frame
+    ostringstream lines;
+    lines.setf(ios::fixed);
+    lines.precision(2);
+    lines << "frame   " << last.frameMs << " ms  (p99 " << framePercentile(0.99f, HISTOGRAM_FRAMES) << ")\n"
+          << "events  " << last.eventMs << " ms  (" << last.events << ")\n"
+          << "update  " << last.updateMs << " ms\n"
+          << "render  " << last.renderMs << " ms\n"
+          << "draws   " << last.drawCalls << "\n"
+          << "lines   " << last.lines << "\n"
+          << "bytes   " << last.bytes << "\n"
+          << "undo    " << last.undoBytes << " bytes\n";
+
+    sf::RectangleShape panel(sf::Vector2f(width, 187.f + histogramHeight));
+    panel.setPosition(left, top);
+    panel.setFillColor(sf::Color(0, 0, 0, 180));
+    window.draw(panel);
+
+    sf::Text text;
+    text.setFont(font);
+    text.setString(lines.str());
+    text.setCharacterSize(14);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(left + 8.f, top + 6.f);
+    window.draw(text);
+
+    // Histogram of the frame times of the last frames, in 2 ms buckets
+    int counts[HISTOGRAM_BUCKETS] = {};
+    size_t first = history.size() > HISTOGRAM_FRAMES ? history.size() - HISTOGRAM_FRAMES : 0;
+    for (size_t i = first; i < history.size(); i++) {
+        int bucket = min(static_cast<int>(history[i].frameMs / BUCKET_MS), HISTOGRAM_BUCKETS - 1);
+        counts[max(bucket, 0)]++;
+    }
+    int highest = *max_element(counts, counts + HISTOGRAM_BUCKETS);
+
+    bars.clear();
+    float barWidth = (width - 16.f) / HISTOGRAM_BUCKETS;
+    float bottom = top + 177.f + histogramHeight;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        float height = histogramHeight * counts[bucket] / max(highest, 1);
+        float x0 = left + 8.f + bucket * barWidth;
+        float x1 = x0 + barWidth - 1.f;
+        // Frames that miss 60 FPS (above 16 ms) are drawn in red
+        sf::Color color = bucket * BUCKET_MS >= 16.f ? sf::Color::Red : sf::Color::Green;
+        sf::Vector2f corners[4] = {sf::Vector2f(x0, bottom - height), sf::Vector2f(x1, bottom - height),
+                                   sf::Vector2f(x1, bottom), sf::Vector2f(x0, bottom)};
+        int order[6] = {0, 1, 2, 0, 2, 3};
+        for (int corner : order) {
+            bars.append(sf::Vertex(corners[corner], color, sf::Vector2f()));
+        }
+    }
+    window.draw(bars);
+}
+
+// Function to write the history as CSV or JSON
+bool FrameStats::exportToFile(const string& filename) const {
+    ofstream output(filename);
+    if (!output) {
+        return false;
+    }
+    bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+
+    if (json) {
+        output << "{\n  \"summary\": {\"frames\": " << droppedFrames + history.size()
+               << ", \"p50_frame_ms\": " << framePercentile(0.5f, history.size())
+               << ", \"p95_frame_ms\": " << framePercentile(0.95f, history.size())
+               << ", \"p99_frame_ms\": " << framePercentile(0.99f, history.size())
+               << ", \"max_frame_ms\": " << framePercentile(1.f, history.size()) << "},\n  \"frames\": [";
+    } else {
+        output << "frame,frame_ms,event_ms,update_ms,render_ms,events,draw_calls,lines,bytes,undo_bytes\n";
+    }
+
+    for (size_t i = 0; i < history.size(); i++) {
+        const FrameSample& sample = history[i];
+        if (json) {
+            output << (i ? ",\n" : "\n") << "    {\"frame\": " << droppedFrames + i
+                   << ", \"frame_ms\": " << sample.frameMs << ", \"event_ms\": " << sample.eventMs
+                   << ", \"update_ms\": " << sample.updateMs << ", \"render_ms\": " << sample.renderMs
+                   << ", \"events\": " << sample.events << ", \"draw_calls\": " << sample.drawCalls
+                   << ", \"lines\": " << sample.lines << ", \"bytes\": " << sample.bytes
+                   << ", \"undo_bytes\": " << sample.undoBytes << "}";
+        } else {
+            output << droppedFrames + i << ',' << sample.frameMs << ',' << sample.eventMs << ',' << sample.updateMs << ','
+                   << sample.renderMs << ',' << sample.events << ',' << sample.drawCalls << ',' << sample.lines << ','
+                   << sample.bytes << ',' << sample.undoBytes << '\n';
+        }
+    }
+
+    if (json) {
+        output << "\n  ]\n}\n";
+    }
+    return static_cast<bool>(output);
+}
+
+// Function to get a percentile of the frame times of the last frames
+float FrameStats::framePercentile(float fraction, size_t frames) const {
+    if (history.empty()) {
+        return 0.f;
+    }
+    vector<float> times;
+    times.reserve(min(frames, history.size()));
+    for (size_t i = history.size() - min(frames, history.size()); i < history.size(); i++) {
+        times.push_back(history[i].frameMs);
+    }
+    size_t index = min(static_cast<size_t>(fraction * (times.size() - 1)), times.size() - 1);
+    nth_element(times.begin(), times.begin() + index, times.end());
+    return times[index];
+}
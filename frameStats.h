@@ -0,0 +1,54 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <SFML/Graphics.hpp>  // Include for drawing the overlay
+#include <deque>              // For the frame history (oldest frames are dropped from the front)
+#include <string>
+
+// FrameSample struct to store the counters of one frame
+struct FrameSample {
+    float frameMs;       // Time since the start of the previous frame
+    float eventMs;       // Time spent polling and handling events
+    float updateMs;      // Time spent in TextEditor::update
+    float renderMs;      // Time spent in TextEditor::render
+    unsigned events;     // Number of events handled
+    unsigned drawCalls;  // Number of draw calls issued by the editor
+    size_t lines;        // Number of lines of the document
+    size_t bytes;        // Size of the document in bytes
+    size_t undoBytes;    // Memory used by the undo history
+};
+
+// FrameStats class to collect the counters of every frame, show them in an overlay and export them
+// The overlay (toggled with F3) shows the latest frame and a histogram of the frame times of the last
+// HISTOGRAM_FRAMES frames. The history of the session is written as CSV or JSON when the editor exits.
+class FrameStats {
+public:
+    // Constructor to keep at most historySize frames (about 18 minutes at 60 FPS by default)
+    explicit FrameStats(size_t historySize = 1 << 16);
+
+    // Method to add the counters of a frame
+    void addFrame(const FrameSample& sample);
+    // Methods to show or hide the overlay
+    void toggleOverlay();
+    bool isOverlayVisible() const;
+    // Method to draw the overlay in the top right corner of the window
+    void render(sf::RenderWindow& window, const sf::Font& font);
+    // Method to write the history as CSV, or as JSON when the file name ends with ".json"
+    bool exportToFile(const std::string& filename) const;
+
+private:
+    static const size_t HISTOGRAM_FRAMES = 240;  // Frames shown in the histogram (4 seconds at 60 FPS)
+    static const int HISTOGRAM_BUCKETS = 17;     // 2 ms buckets, the last one holds every frame above 32 ms
+    static constexpr float BUCKET_MS = 2.f;
+
+    std::deque<FrameSample> history;  // Counters of the latest frames, oldest first
+    size_t maxHistory;                // Maximum number of frames kept
+    size_t droppedFrames;             // Frames dropped from the front of the history
+    bool overlayVisible;              // True while the overlay is drawn
+    sf::VertexArray bars;             // Reusable quads of the histogram
+
+    // Helper to get a percentile of the frame times of the last frames of the history
+    float framePercentile(float fraction, size_t frames) const;
+};
+
+#endif // FRAMESTATS_H
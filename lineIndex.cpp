@@ -0,0 +1,110 @@
+#include    "lineIndex.h" // Include the header file for the lazily built line index
+#include    <algorithm>   // For lower_bound and upper_bound
+#include    "textScan.h"  // For the vectorized line feed kernels
+using namespace std; // Use the standard namespace for convenience
+
+// Constructor to create an index of an empty buffer
+LineIndex::LineIndex() : data(nullptr), size(0), chunkPrefix(1, 0), countedChunks(0), stopRequested(false) {}
+
+// Destructor to stop the counting thread
+LineIndex::~LineIndex() {
+    cancel();
+}
+
+// Function to index a new buffer
+void LineIndex::build(const char* buffer, size_t bufferSize, bool background) {
+    cancel();  // A previous buffer may still be counted
+    data = buffer;
+    size = bufferSize;
+    size_t chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    // Every table is sized up front, so the worker never reallocates memory the UI thread reads
+    chunkPrefix.assign(chunks + 1, 0);
+    chunkBreaks.assign(chunks, vector<uint32_t>());
+    chunkReady.assign(chunks, false);
+    countedChunks.store(0);
+    stopRequested.store(false);
+
+    if (background) {
+        worker = thread(&LineIndex::countChunks, this);
+    } else {
+        countChunks();
+    }
+}
+
+// Function to stop the counting thread
+void LineIndex::cancel() {
+    stopRequested.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+// Function to get how many bytes have been counted
+size_t LineIndex::countedBytes(size_t* lineFeeds) const {
+    size_t chunks = countedChunks.load(memory_order_acquire);  // Read once so bytes and line feeds match
+    if (lineFeeds) {
+        *lineFeeds = chunkPrefix[chunks];
+    }
+    return min(size, chunks * CHUNK_SIZE);
+}
+
+// Function to count the line feeds of every chunk, in order, publishing each chunk when it is done
+void LineIndex::countChunks() {
+    size_t chunks = chunkBreaks.size();
+    for (size_t chunk = 0; chunk < chunks && !stopRequested.load(memory_order_relaxed); chunk++) {
+        // The counting kernel compares 16 or 32 bytes at a time and runs at memory bandwidth
+        size_t start = chunk * CHUNK_SIZE;
+        size_t count = TextScan::count(data + start, min(size, start + CHUNK_SIZE) - start, '\n');
+        chunkPrefix[chunk + 1] = chunkPrefix[chunk] + count;
+        countedChunks.store(chunk + 1, memory_order_release);  // The UI thread may now use this chunk
+    }
+}
+
+// Function to get the number of line feeds in the whole buffer
+size_t LineIndex::total() const {
+    return chunkPrefix.back();
+}
+
+// Function to count the line feeds before a position
+size_t LineIndex::countBefore(size_t position) const {
+    if (position >= size) {
+        return total();
+    }
+    size_t chunk = position / CHUNK_SIZE;
+    const vector<uint32_t>& breaks = breaksOf(chunk);
+    uint32_t offset = static_cast<uint32_t>(position - chunk * CHUNK_SIZE);
+    return chunkPrefix[chunk] + (lower_bound(breaks.begin(), breaks.end(), offset) - breaks.begin());
+}
+
+// Function to find the position of a line feed from its index
+size_t LineIndex::position(size_t index) const {
+    // The chunk holding the line feed is the last one with fewer line feeds before it than index + 1
+    // Only the published part of chunkPrefix is searched, the worker may still be writing the rest
+    auto published = chunkPrefix.begin() + countedChunks.load(memory_order_acquire) + 1;
+    size_t chunk = upper_bound(chunkPrefix.begin(), published, index) - chunkPrefix.begin() - 1;
+    const vector<uint32_t>& breaks = breaksOf(chunk);
+    return chunk * CHUNK_SIZE + breaks[index - chunkPrefix[chunk]];
+}
+
+// Function to get the number of bytes used by the index
+size_t LineIndex::memoryUsage() const {
+    size_t bytes = chunkPrefix.capacity() * sizeof(size_t) + chunkBreaks.capacity() * sizeof(vector<uint32_t>);
+    for (const vector<uint32_t>& breaks : chunkBreaks) {
+        bytes += breaks.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// Function to scan the line feed offsets of a chunk on first use
+const vector<uint32_t>& LineIndex::breaksOf(size_t chunk) const {
+    if (!chunkReady[chunk]) {
+        vector<uint32_t>& breaks = chunkBreaks[chunk];
+        if (chunk < countedChunks.load(memory_order_acquire)) {
+            breaks.reserve(chunkPrefix[chunk + 1] - chunkPrefix[chunk]);  // The count is already known from build
+        }
+        size_t start = chunk * CHUNK_SIZE;
+        TextScan::findAll(data + start, min(size, start + CHUNK_SIZE) - start, '\n', 0u, breaks);
+        chunkReady[chunk] = true;
+    }
+    return chunkBreaks[chunk];
+}
@@ -0,0 +1,62 @@
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <vector>   // For the per chunk tables
+#include <cstdint>  // For uint32_t offsets
+#include <cstddef>  // For size_t
+#include <atomic>   // For the progress shared with the counting thread
+#include <thread>   // For counting the chunks in the background
+
+// LineIndex class to find the '\n' characters of a large read-only buffer
+// Opening only counts the line feeds of every 1 MB chunk. The positions of the line feeds of a
+// chunk are scanned and stored (as 4 byte offsets inside the chunk) the first time a query needs
+// them, so the memory used grows with the number of lines that were looked at, not the file size.
+// The counting can run on a worker thread; the chunks counted so far can be queried while it runs.
+class LineIndex {
+public:
+    // Constructor to create an index of an empty buffer
+    LineIndex();
+    // Destructor to stop the counting thread
+    ~LineIndex();
+
+    // The counting thread works on this object, so it cannot be copied
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    // Method to index a new buffer; only the line feeds of every chunk are counted
+    // When background is true the chunks are counted by a worker thread and build returns at once.
+    void build(const char* data, size_t size, bool background = false);
+    // Method to stop the counting thread (the chunks counted so far stay usable)
+    void cancel();
+    // Method to get how many bytes from the start of the buffer have been counted, and the line feeds in them
+    // Only positions below this value (or the end of a fully counted buffer) may be queried.
+    size_t countedBytes(size_t* lineFeeds = nullptr) const;
+    // Method to get the number of line feeds in the whole buffer
+    size_t total() const;
+    // Method to get the number of line feeds before a position
+    size_t countBefore(size_t position) const;
+    // Method to get the position of a line feed from its index (0 is the first line feed of the buffer)
+    size_t position(size_t index) const;
+    // Method to get the number of bytes used by the index
+    size_t memoryUsage() const;
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;  // Bytes covered by one chunk
+
+    const char* data;                                 // Indexed buffer (not owned)
+    size_t size;                                      // Size of the indexed buffer
+    std::vector<size_t> chunkPrefix;                  // Line feeds before every chunk (one extra entry for the total)
+    mutable std::vector<std::vector<uint32_t>> chunkBreaks; // Line feed offsets of every chunk, filled on first use
+    mutable std::vector<bool> chunkReady;             // True once the offsets of a chunk have been scanned
+
+    std::thread worker;                               // Thread counting the chunks in the background
+    std::atomic<size_t> countedChunks;                // Chunks whose count is published in chunkPrefix
+    std::atomic<bool> stopRequested;                  // Set to ask the worker to stop early
+
+    // Helper run by the worker (or directly) to count every chunk in order
+    void countChunks();
+    // Helper to scan the line feed offsets of a chunk if that was not done yet
+    const std::vector<uint32_t>& breaksOf(size_t chunk) const;
+};
+
+#endif // LINEINDEX_H
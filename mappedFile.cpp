@@ -0,0 +1,119 @@
+#include    "mappedFile.h" // Include the header file for the memory mapped file
+#ifdef _WIN32
+#include    <windows.h>    // For CreateFileMapping and MapViewOfFile
+#else
+#include    <fcntl.h>      // For open
+#include    <sys/mman.h>   // For mmap and munmap
+#include    <sys/stat.h>   // For fstat to get the file size
+#include    <unistd.h>     // For close
+#endif
+using namespace std; // Use the standard namespace for convenience
+
+// Constructor to create an object that maps nothing
+#ifdef _WIN32
+MappedFile::MappedFile() : bytes(nullptr), length(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+#else
+MappedFile::MappedFile() : bytes(nullptr), length(0) {}
+#endif
+
+// Destructor to unmap the file
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+// Function to map a file read-only with the Win32 API
+bool MappedFile::open(const string& filename) {
+    close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        return true;  // An empty file cannot be mapped, but it is still a valid (empty) file
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle) {
+        bytes = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!bytes) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Function to unmap the current file and close its handles
+void MappedFile::close() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    bytes = nullptr;
+    length = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+#else
+// Function to map a file read-only with mmap
+bool MappedFile::open(const string& filename) {
+    close();
+    int descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        ::close(descriptor);
+        return true;  // An empty file cannot be mapped, but it is still a valid (empty) file
+    }
+
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);  // The mapping keeps the file alive, the descriptor is not needed anymore
+    if (view == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    // The file is read from front to back when the line index is built
+    madvise(view, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char*>(view);
+    return true;
+}
+
+// Function to unmap the current file
+void MappedFile::close() {
+    if (bytes) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+    bytes = nullptr;
+    length = 0;
+}
+#endif
+
+// Function to get the first byte of the mapping
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+// Function to get the size of the mapping
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>   // For the file name
+#include <cstddef>  // For size_t
+
+// MappedFile class to map a whole file read-only into memory
+// The operating system pages the file in on demand, so opening a huge file does not read it
+// and the bytes are shared with the page cache instead of being copied into the process.
+class MappedFile {
+public:
+    // Constructor to create an object that maps nothing
+    MappedFile();
+    // Destructor to unmap the file
+    ~MappedFile();
+
+    // A mapping has a single owner, so it cannot be copied
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Method to map a file, returns false when the file cannot be opened or mapped
+    bool open(const std::string& filename);
+    // Method to unmap the current file
+    void close();
+    // Method to get the first byte of the mapping (nullptr for an empty file)
+    const char* data() const;
+    // Method to get the size of the mapping
+    size_t size() const;
+
+private:
+    const char* bytes;  // Start of the mapped view
+    size_t length;      // Size of the mapped file
+#ifdef _WIN32
+    void* fileHandle;     // Handle of the opened file
+    void* mappingHandle;  // Handle of the file mapping object
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,90 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <vector>   // For the list of slabs
+#include <memory>   // For the slabs owned by the pool
+#include <cstddef>  // For size_t
+
+// NodePool class to allocate the nodes of a tree from large slabs
+// Nodes are carved out of slabs that double in size (64 nodes up to 64K nodes), and a freed node goes
+// to a free list that the next allocation takes from first. Building and editing a tree therefore makes
+// one allocation per slab instead of one per node, neighbouring nodes share cache lines, and
+// releaseAll() drops every node at once without visiting them when the document is replaced.
+// T must be trivially copyable (it is stored in a union with the free list link).
+template <typename T>
+class NodePool {
+public:
+    // Constructor to create an empty pool; no slab is allocated until the first node
+    NodePool() : freeList(nullptr), used(0), capacity(0), live(0) {}
+
+    // The nodes point to each other, so the pool cannot be copied
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // Method to get storage for one node (its content is not initialized)
+    T* allocate() {
+        live++;
+        if (freeList) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return &slot->value;
+        }
+        if (used == capacity) {
+            // The next slab is twice as big as the last one, so the number of slabs stays logarithmic
+            capacity = slabs.empty() ? FIRST_SLAB : (capacity < MAX_SLAB ? capacity * 2 : MAX_SLAB);
+            slabs.emplace_back(new Slot[capacity]);
+            used = 0;
+        }
+        return &slabs.back()[used++].value;
+    }
+
+    // Method to give a node back; its storage is reused by the next allocation
+    void release(T* node) {
+        Slot* slot = reinterpret_cast<Slot*>(node);  // value is the first member of the slot
+        slot->next = freeList;
+        freeList = slot;
+        live--;
+    }
+
+    // Method to free every node at once (the nodes must not be used anymore)
+    void releaseAll() {
+        slabs.clear();
+        freeList = nullptr;
+        used = 0;
+        capacity = 0;
+        live = 0;
+    }
+
+    // Method to get the number of nodes in use
+    size_t size() const {
+        return live;
+    }
+
+    // Method to get the number of bytes allocated for the slabs
+    size_t memoryUsage() const {
+        size_t slots = 0;
+        for (size_t slab = 0, slabSize = FIRST_SLAB; slab < slabs.size(); slab++) {
+            slots += slabSize;
+            slabSize = slabSize < MAX_SLAB ? slabSize * 2 : MAX_SLAB;
+        }
+        return slots * sizeof(Slot) + slabs.capacity() * sizeof(slabs[0]);
+    }
+
+private:
+    static constexpr size_t FIRST_SLAB = 64;       // Nodes in the first slab
+    static constexpr size_t MAX_SLAB = 64 * 1024;  // Nodes in the largest slabs
+
+    // Slot union to hold either a node or the link to the next free slot
+    union Slot {
+        T value;
+        Slot* next;
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs; // Every slab, the newest last
+    Slot* freeList;  // Freed slots, the most recently freed first
+    size_t used;     // Slots of the newest slab handed out so far
+    size_t capacity; // Slots of the newest slab
+    size_t live;     // Nodes in use
+};
+
+#endif // NODEPOOL_H
@@ -1,464 +1,294 @@
 #include    "notepad.h" // Include the header file for the notepad functionality
 #include    <iostream>    // Include iostream for input and output
-#include    <fstream>  // Include the header for file handling
-#include    "cstringMethods.h" // Include a user defined class to handle array operations
+#include    <cstring>  // Include for memchr
+#include    <filesystem> // Include for the size of the base file of a recovery journal
 using namespace std; // Use the standard namespace for convenience
 
-// Global stack for undo operations to store the commands for undo functionality
-stack<Command> undoStack;
+// Layout of the text area
+const float TEXT_TOP = 50.f;     // Vertical position of the first visible line (below the "Open File" button)
+const float LINE_HEIGHT = 30.f;  // Vertical distance between two lines
+const size_t OVERSCAN_LINES = 1; // Extra lines drawn below the viewport so a partly visible line is not cut off
+const unsigned CHARACTER_SIZE = 24; // Font size of the text and of the line numbers
 
-// Function to clear the undo stack
-void TextEditor::clearstack() {
-    // Clear the undo stack
-    while(!undoStack.empty()){
-        undoStack.pop();
-    }
-}
-// Command struct's setCommand method that initializes the operation type and associated character
-// This method is used to set the type of operation (e.g., ADD, DELETE) and the associated character.
-void Command::setCommand(Operation operation, char character) {
-    op = operation;  // Set the operation type (ADD, DELETE, NEXTLINE ,CursorLeft,CursorRight,CursorUp,CursorDown)
-    text = character; // Set the character related to the operation (the character that was added or deleted)
-    cout<<"\nSet command called operation->"<<op<<" character->"<<text<<endl;
-}
-void Command::setCursorCommand(Operation operation){
-    op = operation;
-    text = {};
-    cout<<"\nSet Command Cursor called operation->"<<op<<" character->"<<text<<endl;
-}
-
-// LineNode definitions
-
-// Constructor to initialize a new line node with a specified capacity
-LineNode::LineNode(size_t cap)
-        : capacity(cap), length(0), cursorPos(0), prev(nullptr), next(nullptr) {
-        line = new char[capacity];  // Dynamically allocate memory for the line with the specified capacity
-        line[0] = '\0'; // Null-terminate the string initially to indicate an empty line
-    }
-
-// Destructor to free the dynamically allocated memory for the line
-LineNode::~LineNode() {
-    delete[] line; // Delete the dynamically allocated memory for the line
-}
+// Time the cursor stays shown or hidden while the window has the focus
+const int BLINK_MS = 500;
+// Time between two checks of a highlighter pass running on the worker
+const int HIGHLIGHT_POLL_MS = 10;
 
-// Method to append a character to the current line and handle undo operation
-void LineNode::appendChar(char c) {
-        // If there is not enough space in the current line, double the capacity
-        if (length + 1 >= capacity) {
-            resize(capacity * 2); // Resize the line to double the current capacity if necessary
-        }
-
-        // Shift characters to the right to make space for the new character
-        for (size_t i = length; i > cursorPos; --i) {
-            line[i] = line[i - 1]; // Shift the characters to the right starting from the cursor position
-        }
+// File written by Ctrl+S
+const char* const TextEditor::SAVE_FILE = "notepad.txt";
 
-        // Insert the new character at the cursor position
-        line[cursorPos] = c;
+// Save mark of a save whose file is not the base of the recovery journal (another file was opened since it started)
+const size_t NO_SAVE_MARK = static_cast<size_t>(-1);
 
-        // Create a Command object to store the current operation (ADD)
-        Command cmd;
-        cmd.setCommand(Command::ADD, c); // Set the command type to ADD and store the character
-        undoStack.push(cmd); // Push the command onto the undo stack to allow undoing later
+// Colors of the syntax tokens, in the order of SyntaxHighlighter::Kind (keyword, string, comment, number, directive)
+const sf::Color TOKEN_COLORS[] = {
+    sf::Color(0, 0, 200), sf::Color(163, 21, 21), sf::Color(0, 128, 0), sf::Color(9, 134, 88), sf::Color(175, 0, 219)
+};
 
-        length++; // Update the length of the line after adding the character
-        cursorPos++; // Move the cursor forward after inserting the character
-
-        // Null-terminate the string after appending the character
-        line[length] = '\0';
+// Function to clear the undo history
+void TextEditor::clearstack() {
+    // Forget every undo and redo step
+    journal.clear();
 }
 
-
-// function to remove a character at the cursor position
-void LineNode::removeChar() {
-        // check if the cursor position is greater than 0 (i.e., not at the start of the line)
-        if (cursorPos > 0) {
-            char removedChar = line[cursorPos - 1];  // store the character that will be removed
-            cout << "deleted character is " << removedChar << endl;  // print the deleted character
-            Command cmd;
-            cmd.setCommand(Command::DELETE, removedChar); // store the DELETE operation
-            undoStack.push(cmd); // push the DELETE operation onto the undo stack for later undo
-            // shift all characters after the cursor position to the left to remove the character
-            for (size_t i = cursorPos; i < length; ++i) {
-                line[i - 1] = line[i];  // shift each character to the left
-            }
-            length--;  // reduce the length of the line after removing a character
-            cursorPos--;  // move the cursor position back by one
-            line[length] = '\0'; // null-terminate the string after removing the character
-        }
-    }
-
-// function to resize the line to a new capacity
-void LineNode::resize(size_t newCapacity) {
-        char* newLine = new char[newCapacity];  // create a new array with the new capacity
-        // customMemcpy(newLine, line, length); // copy the old data to the new space
-        customMemcpy(newLine, line, length);
-        newLine[length] = '\0'; // null-terminate the string
-        delete[] line; // free the old memory to avoid memory leak
-        line = newLine; // point to the newly allocated memory
-        capacity = newCapacity; // update the capacity to the new capacity
-    }
-
-// function to move the cursor left by one position
-void LineNode::moveCursorLeft() {
-        if (cursorPos > 0) {  // check if the cursor is not at the start of the line
-            cursorPos--;  // move the cursor left by one position
-            Command cmd;
-            cmd.setCursorCommand(Command::CursorLeft);
-            undoStack.push(cmd);
-            return ;
-        }
-         
-    }
-
-// function to move the cursor right by one position
-void LineNode::moveCursorRight() {
-        if (cursorPos < length) {  // check if the cursor is not at the end of the line
-            cursorPos++;  // move the cursor right by one position
-            Command cmd;
-            cmd.setCursorCommand(Command::CursorRight);
-            undoStack.push(cmd);
-            return;
-        }
-    }
-
-
-
 // texteditor definitions
-// constructor to initialize the text editor with a new line and load the font
-TextEditor::TextEditor() : currentLine(new LineNode()), cursorVisible(true),head(currentLine) {
-        // try to load the font file, and if it fails, throw an error
-        if (!font.loadFromFile("Roboto-Light.ttf")) {
+// constructor to initialize the text editor with an empty document and load the font
+// Without the font the editor can still be driven by events, but not rendered (used by the replay benchmark)
+TextEditor::TextEditor(bool loadFont) : cursorLine(0), cursorColumn(0), preferredX(-1.f), topLine(0), leftColumn(0), textWidth(800.f - TextRenderer::MIN_TEXT_X), visibleLines(1), batchedRendering(true), cursorVisible(true), focused(true), shiftHeld(false), damaged(true), workShown(false), drawCalls(0), gotoLineActive(false), findActive(false), findOrigin(0), regexMode(false), regexStale(false), findJumpPending(false), replaceFocus(false), replacePending(false), matchQuads(sf::Triangles), saveMark(0) {
+        // try to load the font file and build the glyph atlas, and if it fails, throw an error
+        if (loadFont && !textRenderer.loadFromFile("Roboto-Light.ttf", CHARACTER_SIZE)) {
             throw runtime_error("Font file not found");  // font not found exception
         }
     }
 
-// destructor to clean up memory and delete each line in the text editor
+// destructor; the piece table frees its own nodes
 TextEditor::~TextEditor() {
-        LineNode* node = currentLine;  // start from the current line
-        // iterate through all lines in the editor
-        while (node) {
-            LineNode* toDelete = node;  // store the current node for deletion
-            node = node->prev;  // move to the previous line
-            delete toDelete;  // free the memory for the current line
-        }
+    // A save that is still running is finished before the editor goes away
+    SaveResult saved;
+    saver.wait();
+    if (saver.poll(saved)) {
+        finishSave(saved);
     }
+    // The editor closes normally, so there is nothing to recover at the next start
+    recovery.close();
+}
 
+// function to get the document offset of the cursor
+size_t TextEditor::cursorOffset() const {
+    return document.lineStart(cursorLine) + cursorColumn;
+}
 
-void TextEditor::undo() {
-    // Check if there are any commands in the undo stack to undo
-    if (!undoStack.empty()) {
-        // Get the last command from the undo stack
-        Command lastCommand = undoStack.top();
-        undoStack.pop();
-
-        // Debug: Log the operation being undone
-        cout << "Undo operation: ";
-        
-        // Check the type of operation (ADD, DELETE, NEXTLINE)
-        switch (lastCommand.op) {
-            case Command::ADD: 
-                cout << "ADD";  // If the operation was an addition
-                break;
-            case Command::DELETE: 
-                cout << "DELETE";  // If the operation was a deletion
-                break;
-            case Command::NEXTLINE: 
-                cout << "NEXTLINE";  // If the operation was a new line creation
-                break;
-            case Command :: CursorDown:
-                cout<<" Cursor Down";
-                break;
-            case Command :: CursorLeft:
-                cout<<" Cursor Left";
-                break;
-            case Command :: CursorUp:
-                cout<<" Cursor Up";
-                break;
-            case Command :: CursorRight:
-                cout<<" Cursor Right";
-                break;
-        }
-        cout << " with character: " << lastCommand.text << "\n";  // Log the character affected
-
-        // If the operation was an ADD operation (i.e., a character was added)
-        if (lastCommand.op == Command::ADD) {
-            // Ensure cursor is at a valid position before deletion
-            if (currentLine->cursorPos > 0|| currentLine->cursorPos == 0) {
-                if(currentLine->cursorPos == 0){
-                    cout<<"\nThe pos is 0 now\n";
-                    if(currentLine->prev != nullptr){
-                    currentLine = currentLine->prev;
-                    currentLine->cursorPos = currentLine->length;
-                    }
-                }
-                else if (currentLine->cursorPos > 0) {  // check if the cursor is not at the start of the line
-                        currentLine->cursorPos--;  // move the cursor left by one position
-                }
-                // Shift all characters after the cursor one position to the left
-                for (size_t i = currentLine->cursorPos; i < currentLine->length; ++i) {
-                    currentLine->line[i] = currentLine->line[i + 1];
-                }
-                currentLine->length--;  // Decrease the length of the line
-                currentLine->line[currentLine->length] = '\0';  // Null-terminate the string
-
-                // Debug: Log the updated cursor position and line state
-                cout << "Cursor position after undoing ADD: " << currentLine->cursorPos << "\n";
-                cout << "Line after undoing ADD: " << currentLine->line << "\n";
-            }
-        } 
-        // If the operation was a DELETE (i.e., a character was deleted)
-        else if (lastCommand.op == Command::DELETE) {
-            // Case 1: Cursor is at the beginning of the line and there is a previous line
-            if (currentLine->cursorPos == 0 && currentLine->prev && currentLine->length > 0) {
-                LineNode* prevLine = currentLine->prev; // Get the previous line
-
-                // Move the cursor to the end of the previous line
-                prevLine->cursorPos = prevLine->length;
-
-                // Append the content of the current line to the end of the previous line
-                size_t i = 0;
-                while (i < currentLine->length) {
-                    prevLine->line[prevLine->length] = currentLine->line[i]; // Copy character
-                    prevLine->length++;
-                    currentLine->line[i] = '\0'; // Clear the character from the current line
-                    i++;
-                }
-                prevLine->line[prevLine->length] = '\0'; // Null-terminate the updated previous line
-
-                // Update the doubly linked list pointers
-                if (currentLine->next != nullptr) {
-                    prevLine->next = currentLine->next;
-                    currentLine->next->prev = prevLine;
-                } else {
-                    prevLine->next = nullptr;
-                }
+// function to place the cursor at a document offset
+void TextEditor::setCursorOffset(size_t offset) {
+    if (offset > document.length()) {
+        offset = document.length();  // Keep the cursor inside the document
+    }
+    cursorLine = document.lineOfOffset(offset);
+    cursorColumn = offset - document.lineStart(cursorLine);
+    preferredX = -1.f;
+    damaged = true;
+}
 
-                // Delete the current line and move the cursor to the previous line
-                delete currentLine;
-                currentLine = prevLine;
+// function to move the cursor to another line, keeping its x position rather than its column
+// The font is proportional, so the same column of two lines is rarely at the same place on screen.
+void TextEditor::moveCursorToLine(size_t line) {
+    if (preferredX < 0.f) {
+        // The first vertical move remembers where it started (x positions start at the left of the text area)
+        const std::vector<float>& advances = lineAdvances(cursorLine);
+        size_t inView = cursorColumn > leftColumn ? cursorColumn - leftColumn : 0;
+        preferredX = advances[min(inView, advances.size() - 1)];
+    }
+    cursorLine = line;
+    cursorColumn = min(leftColumn + TextRenderer::xToColumn(lineAdvances(line), preferredX), document.lineLength(line));
+}
 
-                // Debug: Log the updated cursor position and line state
-                cout << "Cursor position after merging lines: " << currentLine->cursorPos << "\n";
-                cout << "Line after merging: " << currentLine->line << "\n";
-            } 
-            // Case 2: Regular DELETE undo (restore character)
-            else {
-                // Ensure the line has enough space to restore the character
-                if (currentLine->length + 1 >= currentLine->capacity) {
-                    currentLine->resize(currentLine->capacity * 2);  // Resize if necessary
-                }
-                // Shift characters after the cursor one position to the right
-                for (size_t i = currentLine->length; i > currentLine->cursorPos; --i) {
-                    currentLine->line[i] = currentLine->line[i - 1];
-                }
-                currentLine->line[currentLine->cursorPos] = lastCommand.text;  // Insert the deleted character
-                currentLine->length++;  // Increase the length of the line
-                currentLine->line[currentLine->length] = '\0';  // Null-terminate the string
-
-                // Move the cursor to the right after restoring the character
-                if (currentLine->cursorPos == currentLine->length) {
-                    if (currentLine->next != nullptr) {
-                        currentLine = currentLine->next;
-                        currentLine->cursorPos = 0;
-                    }
-                } else if (currentLine->cursorPos < currentLine->length) {  
-                    currentLine->cursorPos++;  // Move the cursor right by one position
-                }
+// function to get the x position of every visible column of a line (column leftColumn is at x = 0)
+// Only a line that is not cached is copied out of the document; the edits invalidate the lines they change.
+const std::vector<float>& TextEditor::lineAdvances(size_t line) {
+    const std::vector<float>* cached = textRenderer.cachedAdvances(line);
+    if (cached && cached->size() == visibleLength(line) + 1) {
+        return *cached;
+    }
+    return textRenderer.lineAdvances(line, visibleText(line));
+}
 
-                // Debug: Log the updated cursor position and line state
-                cout << "Cursor position after undoing DELETE: " << currentLine->cursorPos << "\n";
-                cout << "Line after undoing DELETE: " << currentLine->line << "\n";
-            }
-        }
+// function to get the number of characters of a line inside the visible columns
+size_t TextEditor::visibleLength(size_t line) const {
+    size_t length = document.lineLength(line);
+    return length > leftColumn ? min(length - leftColumn, textRenderer.columnsFitting(textWidth)) : 0;
+}
 
-        // If the operation was a NEXTLINE (i.e., a new line was created)
-        else if (lastCommand.op == Command::NEXTLINE) {
-            // Ensure the previous line exists
-            if (currentLine->prev) {
-                LineNode* toDelete = currentLine;  // Store reference to the current line
-                currentLine = currentLine->prev;  // Move to the previous line
+// function to copy the visible columns of a line out of the document
+// Only what can fit in the text area is copied, measured and drawn, so a line of many megabytes costs
+// no more than a short one.
+std::string TextEditor::visibleText(size_t line) const {
+    return document.getText(document.lineStart(line) + leftColumn, visibleLength(line));
+}
 
-                // Merge the content of the current line into the previous line
-                size_t originalLength = currentLine->length;  // Store original length
-                size_t newLength = currentLine->length + toDelete->length;  // Calculate new length
+// function to scroll the view horizontally so that column becomes the first visible column
+void TextEditor::setLeftColumn(size_t column) {
+    if (column != leftColumn) {
+        leftColumn = column;
+        textRenderer.invalidateLinesFrom(0);  // Every measured line starts at another column now
+        preferredX = -1.f;
+        damaged = true;
+    }
+}
 
-                // Ensure the previous line has enough capacity
-                if (newLength >= currentLine->capacity) {
-                    currentLine->resize(newLength * 2);  // Resize as necessary
-                }
+// function to get how far the view can be scrolled sideways
+// Like the cursor-follow path, the end of the line is measured with the real glyph advances, so it lands
+// at the right edge of the text area whatever characters it is made of.
+size_t TextEditor::lastLeftColumn() const {
+    size_t longestLine = topLine;
+    size_t endLine = min(topLine + visibleLines, document.lineCount());
+    for (size_t line = topLine + 1; line < endLine; line++) {
+        if (document.lineLength(line) > document.lineLength(longestLine)) {
+            longestLine = line;
+        }
+    }
+    size_t longest = document.lineLength(longestLine);
+    size_t before = min(longest, textRenderer.columnsFitting(textWidth));
+    size_t back = textRenderer.columnsBefore(document.getText(document.lineStart(longestLine) + longest - before, before), textWidth);
+    return longest - back;
+}
 
-                // Append content of the deleted line to the previous line
-                for (size_t i = 0; i < toDelete->length; ++i) {
-                    currentLine->line[originalLength + i] = toDelete->line[i];
-                }
-                currentLine->length = newLength;  // Update the length
-                currentLine->line[currentLine->length] = '\0';  // Null-terminate the string
+// function to scroll the viewport by a number of lines
+void TextEditor::scrollBy(long lines) {
+    size_t lastTop = document.lineCount() - 1;  // The last line may be scrolled up to the top of the window
+    if (lines < 0) {
+        size_t up = static_cast<size_t>(-lines);
+        topLine = up > topLine ? 0 : topLine - up;
+    } else {
+        topLine = min(topLine + static_cast<size_t>(lines), lastTop);
+    }
+}
 
-                // Update links to bypass the deleted line
-                currentLine->next = toDelete->next;
-                if (toDelete->next) {
-                 toDelete->next->prev = currentLine;
-                }
+// function to scroll just enough to bring the cursor line into the viewport
+void TextEditor::scrollToCursor() {
+    if (cursorLine < topLine) {
+        topLine = cursorLine;  // The cursor is above the viewport, so it becomes the first line
+    } else if (cursorLine >= topLine + visibleLines) {
+        topLine = cursorLine - visibleLines + 1;  // The cursor is below the viewport, so it becomes the last line
+    }
 
-                // Free the memory of the deleted line
-                delete toDelete;
+    // Horizontally, a cursor that leaves the text area is brought back a quarter of the width inside it
+    if (cursorColumn < leftColumn) {
+        size_t start = document.lineStart(cursorLine);
+        size_t before = min(cursorColumn, textRenderer.columnsFitting(textWidth));
+        size_t back = textRenderer.columnsBefore(document.getText(start + cursorColumn - before, before), textWidth / 4);
+        setLeftColumn(cursorColumn - back);
+    } else {
+        const std::vector<float>& advances = lineAdvances(cursorLine);
+        size_t inView = cursorColumn - leftColumn;
+        if (inView >= advances.size() || advances[inView] > textWidth) {
+            size_t start = document.lineStart(cursorLine);
+            size_t before = min(cursorColumn, textRenderer.columnsFitting(textWidth));
+            size_t back = textRenderer.columnsBefore(document.getText(start + cursorColumn - before, before), textWidth * 3 / 4);
+            setLeftColumn(cursorColumn - back);
+        }
+    }
+}
 
-                // Move the cursor to the end of the previous line
-                currentLine->cursorPos = originalLength;
+void TextEditor::undo() {
+    // Take the newest transaction from the journal
+    const Transaction* transaction = journal.undo();
+    if (!transaction) {
+        // Debug: Log when there is no operation to undo
+        TRACE_DEBUG("undo: history is empty");
+        return;
+    }
 
-                // Debug: Log the updated cursor position and merged line content
-                cout << "Cursor position after undoing NEXTLINE: " << currentLine->cursorPos << "\n";
-                cout << "Merged line content: " << currentLine->line << "\n";
+    // Revert its edits from the last to the first; each one is a single piece table operation, whatever its size
+    for (auto edit = transaction->edits.rbegin(); edit != transaction->edits.rend(); ++edit) {
+        if (edit->op == Command::ADD) {
+            eraseText(edit->position, edit->text.size());  // A removed '\n' merges the two lines back
+        } else if (edit->op == Command::DELETE) {
+            insertText(edit->position, edit->text.data(), edit->text.size());  // A restored '\n' splits the line again
+        } else {
+            // A replace-all is reverted by the opposite batch: every new text goes back to the removed one
+            std::vector<Replacement> inverse;
+            inverse.reserve(edit->ranges.size());
+            size_t shift = 0;  // Growth of the document before the range (wraps around when it shrank)
+            for (const Replacement& range : edit->ranges) {
+                inverse.push_back(Replacement{range.position + shift, range.newLength, range.oldLength});
+                shift += range.newLength - range.oldLength;
             }
+            replaceRanges(inverse, edit->text);
         }
+    }
+    setCursorOffset(transaction->cursorBefore);
+}
 
-                else if(lastCommand.op == Command::CursorUp){
-            if (currentLine->next != nullptr) {
-            // Move to the previous line
-            currentLine->next->cursorPos=currentLine->cursorPos;
-            currentLine = currentLine->next;
-            } else {
-            cout << "\nNo Next Line line\n"; // Debugging output
-            }
-        }
-        else if(lastCommand.op == Command::CursorDown){
-             if (currentLine->prev != nullptr) {
-            // Move to the previous line
-            currentLine->prev->cursorPos=currentLine->cursorPos;
-            currentLine = currentLine->prev;
-            } else {
-                cout << "\nNo previous line\n"; // Debugging output
-                }
-        }
-        else if(lastCommand.op == Command::CursorRight){
-            if(currentLine->cursorPos == 0){
-                cout<<"\nThe pos is 0 now\n";
-                if(currentLine->prev != nullptr){
-                    currentLine = currentLine->prev;
-                    currentLine->cursorPos = currentLine->length;
-                }
-            }
-            else if (currentLine->cursorPos > 0) {  // check if the cursor is not at the start of the line
-                currentLine->cursorPos--;  // move the cursor left by one position
-            }
-            
-        }
-        else if(lastCommand.op == Command::CursorLeft){
-            if(currentLine->cursorPos == currentLine->length){
-                if(currentLine->next != nullptr){
-                    currentLine = currentLine->next;
-                    currentLine->cursorPos = 0;
-                }
+void TextEditor::redo() {
+    // Take the newest undone transaction from the journal
+    const Transaction* transaction = journal.redo();
+    if (!transaction) {
+        TRACE_DEBUG("redo: nothing to redo");
+        return;
+    }
 
-            }
-            else if (currentLine->cursorPos < currentLine->length) {  // check if the cursor is not at the end of the line
-                currentLine->cursorPos++;  // move the cursor right by one position
-            }
+    // Apply its edits again in their original order
+    for (const Command& edit : transaction->edits) {
+        if (edit.op == Command::ADD) {
+            insertText(edit.position, edit.text.data(), edit.text.size());
+        } else if (edit.op == Command::DELETE) {
+            eraseText(edit.position, edit.text.size());
+        } else {
+            replaceRanges(edit.ranges, edit.replacement);
         }
-    } 
-        // If the undo stack is empty, no operatioDELETEn to undo
-    else {
-        // Debug: Log when there is no operation to undo
-        cout << "Undo stack is empty. No operation to undo.\n";
     }
+    setCursorOffset(transaction->cursorAfter);
 }
 
 
 void TextEditor::handleInput(sf::Event& event) {
+    // Moving the mouse over the window changes nothing that is drawn
+    if (event.type != sf::Event::MouseMoved && event.type != sf::Event::MouseEntered && event.type != sf::Event::MouseLeft) {
+        damaged = true;
+    }
+    // A Shift key changes the state when it goes down or up; every other key carries the current state
+    if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) {
+        bool shiftKey = event.key.code == sf::Keyboard::LShift || event.key.code == sf::Keyboard::RShift;
+        shiftHeld = shiftKey ? event.type == sf::Event::KeyPressed : event.key.shift;
+    }
+    // While the goto-line prompt is open it takes every key
+    if (gotoLineActive) {
+        handleGotoLineInput(event);
+        scrollToCursor();
+        return;
+    }
+    // While the find bar is open it takes the typed text, the other keys still work
+    if (findActive && handleFindInput(event)) {
+        scrollToCursor();
+        return;
+    }
+
     // Check if the event type is TextEntered (i.e., the user has typed something)
     if (event.type == sf::Event::TextEntered) {
         
         // If the user presses the Backspace key (Unicode value '\b')
         if (event.text.unicode == '\b') { 
-            // Case 1: Cursor is at the beginning of the line (cursorPos == 0)
-            if (currentLine->cursorPos == 0 && currentLine->prev) {
-                LineNode* prevLine = currentLine->prev; // Get the previous line
-
-                // Move the cursor to the end of the previous line
-                prevLine->cursorPos = prevLine->length;
-
-                // Append the content of the current line to the end of the previous line
-                size_t i = 0;
-                while (i < currentLine->length) {
-                    prevLine->line[prevLine->length] = currentLine->line[i]; // Copy character
-                    prevLine->length++;
-                    currentLine->line[i] = '\0'; // Clear the character from the current line
-                    i++;
-                }
-                prevLine->line[prevLine->length] = '\0'; // Null-terminate the updated previous line
-
-                // Update the doubly linked list pointers
-                if (currentLine->next != nullptr) {
-                    prevLine->next = currentLine->next;
-                    currentLine->next->prev = prevLine;
-                } else {
-                    prevLine->next = nullptr;
-                }
-
-                // Delete the current line and move the cursor to the previous line
-                delete currentLine;
-                currentLine = prevLine;
-
-                // Add DELETE operation to undo stack
-                Command cmd;
-                cmd.setCommand(Command::DELETE, '\n'); // '\n' represents the removed line break
-                undoStack.push(cmd);
+            size_t offset = cursorOffset();
+            // Case 1: Cursor is at the beginning of the line, so the line break before it is removed
+            if (cursorColumn == 0 && cursorLine > 0) {
+                // The cursor ends up where the previous line used to end
+                size_t previousLength = document.lineLength(cursorLine - 1);
+
+                // Removing the '\n' merges the current line into the previous one
+                eraseText(offset - 1, 1);
+                cursorLine--;
+                cursorColumn = previousLength;
+
+                // Record the removed line break in the undo journal
+                journal.recordErase(offset - 1, "\n", offset, offset - 1);
             } 
             // Case 2: Cursor is not at the beginning of the line
-            else if (currentLine->cursorPos > 0) {
-                // Store the deleted character in the undo stack
-                char deletedChar = currentLine->line[currentLine->cursorPos - 1];
-                Command cmd;
-                cmd.setCommand(Command::DELETE, deletedChar);
-                undoStack.push(cmd);
-
-                // Shift characters to the left to remove the character at cursorPos - 1
-                for (size_t i = currentLine->cursorPos - 1; i < currentLine->length - 1; i++) {
-                    currentLine->line[i] = currentLine->line[i + 1];
-                }
-                currentLine->line[currentLine->length - 1] = '\0'; // Null-terminate
-                currentLine->length--;
+            else if (cursorColumn > 0) {
+                // Store the deleted character in the undo journal (merged with the previous backspaces)
+                char deletedChar = document.charAt(offset - 1);
+                journal.recordErase(offset - 1, string(1, deletedChar), offset, offset - 1);
+
+                // Remove the character before the cursor
+                eraseText(offset - 1, 1);
 
                 // Update the cursor position
-                currentLine->cursorPos--;
+                cursorColumn--;
             }
         }
         
         // If the user presses Enter (Unicode values '\r' or '\n')
         else if (event.text.unicode == '\r' || event.text.unicode == '\n') {
-            // Create a new line node when the user presses Enter
-            LineNode* newLine = new LineNode(); // Allocate a new line node dynamically
-
-            if (currentLine->cursorPos < currentLine->length) {
-                // Cut the characters present after the cursor and paste them into the new line
-                size_t j = 0;
-                for (size_t i = currentLine->cursorPos; i < currentLine->length; i++, j++) {
-                    newLine->line[j] = currentLine->line[i]; // Copy characters to the new line
-                    currentLine->line[i] = '\0'; // Clear characters from the current line
-                }
-                newLine->line[j] = '\0';
-                newLine->length = j; // Update the length of the new line
-                currentLine->length = currentLine->cursorPos; // Update the current line length
-            }
-
-            // Update the doubly linked list pointers
-            newLine->prev = currentLine; // Set the new line's previous pointer to the current line
-            newLine->next = currentLine->next; // Set the new line's next pointer to the current line's next
-
-            if (currentLine->next) {
-                currentLine->next->prev = newLine; // Update the previous pointer of the next line
-            }
-            currentLine->next = newLine; // Link the current line to the new line
+            // Inserting a '\n' splits the line at the cursor; the text after the cursor becomes the new line
+            size_t offset = cursorOffset();
+            insertText(offset, "\n", 1);
 
             // Move the cursor to the start of the new line
-            currentLine = newLine;
-            currentLine->cursorPos = 0;
+            cursorLine++;
+            cursorColumn = 0;
 
-            // Create a NEXTLINE command for the undo stack
-            Command cmd;
-            cmd.setCommand(Command::NEXTLINE, '\n'); // Store the NEXTLINE operation
-            undoStack.push(cmd); // Push the command onto the undo stack
+            // Record the line split in the undo journal, it is always an undo step of its own
+            journal.recordInsert(offset, "\n", offset, offset + 1);
         }
 
         // If the user presses a printable character (excluding control characters like space or special chars)
@@ -466,8 +296,13 @@ void TextEditor::handleInput(sf::Event& event) {
             // Convert the Unicode value to a char
             char insertedChar = static_cast<char>(event.text.unicode);
 
-            // Append the character to the current line
-            currentLine->appendChar(insertedChar);
+            // Insert the character at the cursor
+            size_t offset = cursorOffset();
+            insertText(offset, &insertedChar, 1);
+            cursorColumn++; // Move the cursor forward after inserting the character
+
+            // Record the character in the undo journal; consecutive typing grows a single edit
+            journal.recordInsert(offset, string(1, insertedChar), offset, offset + 1);
         }
     }
     
@@ -489,14 +324,101 @@ void TextEditor::handleInput(sf::Event& event) {
         else if(event.key.code == sf::Keyboard::Down) {
             moveCursorDown();
         }
+
+        // PageUp / PageDown move the cursor and the viewport by one screen
+        else if (event.key.code == sf::Keyboard::PageUp || event.key.code == sf::Keyboard::PageDown) {
+            journal.seal();  // Typing after the jump starts a new undo step
+
+            long page = static_cast<long>(visibleLines);
+            if (event.key.code == sf::Keyboard::PageUp) {
+                moveCursorToLine(cursorLine > visibleLines ? cursorLine - visibleLines : 0);
+                scrollBy(-page);
+            } else {
+                moveCursorToLine(min(cursorLine + visibleLines, document.lineCount() - 1));
+                scrollBy(page);
+            }
+        }
         
+        // If Ctrl+Shift+Z or Ctrl+Y is pressed (Redo operation)
+        else if (event.key.control && ((event.key.code == sf::Keyboard::Z && event.key.shift) || event.key.code == sf::Keyboard::Y)) {
+            redo(); // Call the redo method to apply the last undone operation again
+        }
         // If Ctrl+Z is pressed (Undo operation)
-        else if (event.key.code == sf::Keyboard::Z && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
+        // The modifiers are read from the event, so a replayed event behaves like the real key press
+        else if (event.key.code == sf::Keyboard::Z && event.key.control) {
             undo(); // Call the undo method to undo the last operation
         }
-        else if (event.key.code == sf::Keyboard::S && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
-            saveToFile("notepad.txt"); // Save to file when Ctrl+S is pressed
+        else if (event.key.code == sf::Keyboard::S && event.key.control) {
+            saveToFile(SAVE_FILE); // Save to file when Ctrl+S is pressed
+        }
+        // Ctrl+F opens the find bar, searching from the cursor
+        else if (event.key.code == sf::Keyboard::F && event.key.control) {
+            findActive = true;
+            findOrigin = cursorOffset();
+            replaceFocus = false;
+        }
+        // Ctrl+G opens the goto-line prompt
+        else if (event.key.code == sf::Keyboard::G && event.key.control) {
+            gotoLineActive = true;
+            gotoLineInput.clear();
+        }
+        // Escape cancels a file that is still being opened
+        else if (event.key.code == sf::Keyboard::Escape && document.isLoading()) {
+            document.cancelLoad();
+            recovery.rebase("", recovery.mark());  // The edits from now on are made on an empty document, not on that file
+            highlighter.setLanguage("");           // ... which has no language either
+            textRenderer.invalidateLinesFrom(0);
+            preferredX = -1.f;
+            clearstack();
+            cursorLine = 0;
+            cursorColumn = 0;
+            topLine = 0;
+            leftColumn = 0;
+            TRACE_INFO("open: loading cancelled");
+        }
+        // F2 switches between the glyph atlas renderer and the old sf::Text renderer
+        else if (event.key.code == sf::Keyboard::F2) {
+            batchedRendering = !batchedRendering;
         }
+        // F12 writes the latest traces to trace.log
+        else if (event.key.code == sf::Keyboard::F12) {
+            if (Trace::dumpToFile("trace.log")) {
+                cout << "Traces written to trace.log" << endl;
+            }
+        }
+    }
+
+    // Clicking in the text area puts the cursor at the nearest character edge
+    else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left && event.mouseButton.y >= TEXT_TOP) {
+        journal.seal();  // Typing after the click starts a new undo step
+        size_t row = static_cast<size_t>((event.mouseButton.y - TEXT_TOP) / LINE_HEIGHT);
+        cursorLine = min(topLine + row, document.lineCount() - 1);
+        cursorColumn = min(leftColumn + TextRenderer::xToColumn(lineAdvances(cursorLine), event.mouseButton.x - textRenderer.getTextX()),
+                           document.lineLength(cursorLine));
+        preferredX = -1.f;
+        return;  // The clicked line is already on screen
+    }
+
+    // Scrolling the mouse wheel moves the viewport without moving the cursor
+    // The horizontal wheel, or the wheel with Shift held, scrolls sideways
+    else if (event.type == sf::Event::MouseWheelScrolled) {
+        if (event.mouseWheelScroll.wheel == sf::Mouse::HorizontalWheel || shiftHeld) {
+            long columns = static_cast<long>(-event.mouseWheelScroll.delta * 8);  // Eight columns per wheel step
+            if (columns < 0) {
+                setLeftColumn(static_cast<size_t>(-columns) > leftColumn ? 0 : leftColumn + columns);
+            } else {
+                // Stop once the longest visible line ends at the right edge (the cursor may have scrolled further)
+                setLeftColumn(min(leftColumn + columns, max(lastLeftColumn(), leftColumn)));
+            }
+        } else {
+            scrollBy(static_cast<long>(-event.mouseWheelScroll.delta * 3));  // Three lines per wheel step
+        }
+        return;
+    }
+
+    // Typing and cursor keys always keep the cursor on screen
+    if (event.type == sf::Event::TextEntered || event.type == sf::Event::KeyPressed) {
+        scrollToCursor();
     }
 }
 
@@ -504,290 +426,933 @@ void TextEditor::handleInput(sf::Event& event) {
 
 
 void TextEditor::update() {
+    // While a file is opened in the background, add the part indexed since the last frame
+    if (document.isLoading()) {
+        size_t loaded = document.length();
+        document.pollLoad();
+        textRenderer.invalidateLinesFrom(document.lineOfOffset(loaded));  // The last line may have grown
+        search.onInsert(document, loaded, document.length() - loaded);  // Search the part that was just added
+        regexStale = regexStale || document.length() != loaded;
+    }
+
+    // Lex the lines edited since the last frame, and merge the pass of the lexing thread when it is done
+    if (highlighter.update(document)) {
+        damaged = true;
+    }
+
+    // Report a save that finished since the last frame
+    SaveResult saved;
+    if (saver.poll(saved)) {
+        finishSave(saved);
+    }
+
+    // Take the regex matches the worker found since the last frame
+    if (regexMode) {
+        regexSearch.poll();
+        // After an edit the search starts again on a new snapshot (once per frame, and once the file is fully open)
+        if (regexStale && !document.isLoading()) {
+            regexSearch.start(document, findPattern);
+            regexStale = false;
+        }
+        // Show the first match after the search origin as soon as it is found
+        RegexSearch::Match match;
+        if (findJumpPending && regexSearch.next(findOrigin, match) && (match.offset >= findOrigin || !regexSearch.isSearching())) {
+            journal.seal();
+            setCursorOffset(match.offset);
+            scrollToCursor();
+            findJumpPending = false;
+        }
+        findJumpPending = findJumpPending && regexSearch.isSearching();
+        // A regex replace-all runs once every match is known
+        if (replacePending && !regexSearch.isSearching() && !regexStale) {
+            replacePending = false;
+            replaceAll();
+        }
+    }
+
+    // The progress of a load or of a search is drawn every frame, and once more when it ends
+    bool working = document.isLoading() || (regexMode && regexSearch.isSearching()) || saver.isSaving();
+    damaged = damaged || working || workShown;
+    workShown = working;
+
     // Check if 500 milliseconds have passed since the last update
-    if (clock.getElapsedTime().asMilliseconds() >= 500) {
+    if (focused && clock.getElapsedTime().asMilliseconds() >= BLINK_MS) {
         cursorVisible = !cursorVisible; // Toggle the cursor visibility (make it blink)
+        damaged = true;
         
         // Restart the clock to start counting from zero again
         clock.restart();
     }
 }
 
+// function to know whether the screen must be drawn again
+bool TextEditor::needsRedraw() const {
+    return damaged;
+}
+
+// function to get how long the editor can wait before update() has something to do
+int TextEditor::millisecondsUntilChange() const {
+    if (damaged || workShown || (regexMode && regexStale) || document.isLoading() || regexSearch.isSearching() || saver.isSaving() || highlighter.hasWorkReady()) {
+        return 0;
+    }
+    int wait = -1;  // Without the focus the cursor does not blink, nothing changes until the next event
+    if (focused) {
+        int elapsed = clock.getElapsedTime().asMilliseconds();
+        wait = elapsed < BLINK_MS ? BLINK_MS - elapsed : 0;
+    }
+    // A pass of the highlighter worker is merged once it is done; until then it is checked now and then
+    if (highlighter.isBusy() && (wait < 0 || wait > HIGHLIGHT_POLL_MS)) {
+        wait = HIGHLIGHT_POLL_MS;
+    }
+    return wait;
+}
+
+// function to start or stop the blinking of the cursor when the window gains or loses the focus
+void TextEditor::setFocused(bool hasFocus) {
+    focused = hasFocus;
+    shiftHeld = shiftHeld && hasFocus;  // A key released in another window sends no event here
+    cursorVisible = true;  // A window in the background shows a steady cursor
+    clock.restart();
+    damaged = true;
+}
+
 
 void TextEditor::render(sf::RenderWindow& window) {
-    // Start from the current line and move to the first line in the linked list
-    LineNode* node = currentLine;
-    while (node->prev) {
-        node = node->prev; // Move to the previous line until the first line is reached
+    drawCalls = 0;  // Counted for the instrumentation overlay
+    damaged = false;
+
+    // Work out how many lines fit below the top of the text area
+    float areaHeight = window.getSize().y - TEXT_TOP;
+    visibleLines = areaHeight > LINE_HEIGHT ? static_cast<size_t>(areaHeight / LINE_HEIGHT) : 1;
+
+    // Only the lines inside the viewport are drawn, so the frame cost depends on the window height, not on the file size
+    size_t firstLine = min(topLine, document.lineCount() - 1);
+    size_t endLine = min(firstLine + visibleLines + OVERSCAN_LINES, document.lineCount());
+    float maxWidth = static_cast<float>(window.getSize().x);
+    textRenderer.setLineCount(document.lineCount());  // The gutter grows with the digits of the last line number
+    textWidth = maxWidth - textRenderer.getTextX();
+
+    if (batchedRendering) {
+        textRenderer.beginFrame();
     }
+    matchQuads.clear();
 
     // Initialize the starting position for rendering lines
-    float y = 50.f;  // Vertical position to start drawing text
-    int lineNumber = 1;  // Line number starts from 1
-
-    // Render each line in the linked list
-    while (node) {
-        // Render the line number
-        sf::Text lineNumberText;  // Create a text object to display the line number
-        lineNumberText.setFont(font);  // Set the font for the line number
-        lineNumberText.setString(std::to_string(lineNumber));  // Convert line number to string
-        lineNumberText.setCharacterSize(24);  // Set the font size
-        lineNumberText.setFillColor(sf::Color::Blue);  // Set the text color for line numbers
-        lineNumberText.setPosition(10.f, y);  // Position the line number
-        window.draw(lineNumberText);  // Draw the line number
-
-        // Render the actual line content
-        sf::Text text;  // Create a text object to display the current line
-        text.setFont(font);  // Set the font for the text
-        text.setString(node->line);  // Set the string to the content of the line
-        text.setCharacterSize(24);  // Set the font size for the text
+    float y = TEXT_TOP;  // Vertical position to start drawing text
+    std::string cursorLineText;  // Visible part of the cursor line, needed to place the cursor
+    // The lexer state is carried from one visible line to the next, starting from the cached state above the viewport
+    uint8_t lexState = highlighter.stateBefore(firstLine);
+    std::vector<SyntaxHighlighter::Token> tokens;
+    std::vector<ColorRun> runs;
+
+    // Add each visible line of the document
+    for (size_t lineIndex = firstLine; lineIndex < endLine; lineIndex++) {
+        std::string lineText = visibleText(lineIndex);  // Copy the visible part of the line out of the piece table
+        runs.clear();
+        if (highlighter.isActive()) {
+            lexState = highlighter.lineTokens(document, lineIndex, lexState, tokens);
+            colorRuns(tokens, lineText.size(), runs);
+        }
 
         // Highlight the current line with a background rectangle
-        if (node == currentLine) {
-            sf::RectangleShape highlight(sf::Vector2f(window.getSize().x - 20.f, 30.f));  // Rectangle covering the line
-            highlight.setPosition(50.f, y);  // Position the highlight at the line's position (adjusted for line numbers)
+        if (lineIndex == cursorLine) {
+            sf::RectangleShape highlight(sf::Vector2f(window.getSize().x - 20.f, LINE_HEIGHT));  // Rectangle covering the line
+            highlight.setPosition(textRenderer.getTextX(), y);  // Position the highlight at the line's position (adjusted for line numbers)
             highlight.setFillColor(sf::Color(200, 200, 255, 100));  // Light blue highlight
             window.draw(highlight);  // Draw the highlight rectangle
-
-            // Render the cursor if it's visible
-            if (cursorVisible) {
-                sf::Text cursorText;
-                cursorText.setFont(font);
-                cursorText.setString(node->line);
-                cursorText.setCharacterSize(24);
-                cursorText.setPosition(50.f, y);
-                
-                sf::Vector2f cursorPos = cursorText.findCharacterPos(currentLine->cursorPos);
-
-                // Create a rectangle shape to represent the cursor
-                sf::RectangleShape cursor(sf::Vector2f(2.f, 24.f));  // A vertical line as the cursor
-                cursor.setPosition(cursorPos.x, cursorPos.y);  // Position the cursor
-                cursor.setFillColor(sf::Color::Black);  // Set the cursor color
-                window.draw(cursor);  // Draw the cursor onto the window
-            }
+            drawCalls++;
+            cursorLineText = lineText;
         }
 
-        text.setFillColor(sf::Color::Black);  // Set the text color to black
-        text.setPosition(50.f, y);  // Position the text on the screen (adjusted for line numbers)
-        window.draw(text);  // Draw the text onto the window
+        if (batchedRendering) {
+            textRenderer.addLine(lineIndex, lineText, y, maxWidth, runs);  // Reuses the quads of the line when it did not change
+        } else {
+            renderLineWithText(window, lineIndex, lineText, y);
+        }
+        addMatchQuads(lineIndex, lineText, y);
 
         // Update vertical position for the next line
-        y += 30.f;
+        y += LINE_HEIGHT;
+    }
 
-        // Move to the next line in the linked list
-        node = node->next;
-        lineNumber++;  // Increment the line number
+    // Every glyph of the frame is drawn with one draw call
+    if (batchedRendering) {
+        textRenderer.draw(window);
+        drawCalls++;
     }
-}
 
+    // The search matches are highlighted over the text with translucent quads, in one draw call
+    if (matchQuads.getVertexCount() > 0) {
+        window.draw(matchQuads);
+        drawCalls++;
+    }
 
-void TextEditor::saveToFile(const std::string& filename) {
-    ofstream outFile(filename);  // Open the file in write mode
+    // Show how much of the file has been opened while it is still streaming in, or written while it is saved
+    if (document.isLoading() || saver.isSaving()) {
+        float progress = document.isLoading() ? document.loadProgress() : saver.progress();
+        sf::RectangleShape progressBackground(sf::Vector2f(200.f, 20.f));
+        progressBackground.setPosition(150.f, 20.f);
+        progressBackground.setFillColor(sf::Color(220, 220, 220));
+        window.draw(progressBackground);
+
+        sf::RectangleShape progressBar(sf::Vector2f(200.f * progress, 20.f));
+        progressBar.setPosition(150.f, 20.f);
+        progressBar.setFillColor(sf::Color::Green);
+        window.draw(progressBar);
+
+        sf::Text progressText;
+        progressText.setFont(textRenderer.getFont());
+        std::string percent = std::to_string(static_cast<int>(progress * 100)) + "%";
+        progressText.setString(document.isLoading() ? "Loading " + percent + " (Esc to cancel)" : "Saving " + percent);
+        progressText.setCharacterSize(18);
+        progressText.setFillColor(sf::Color::Black);
+        progressText.setPosition(360.f, 18.f);
+        window.draw(progressText);
+        drawCalls += 3;
+    }
 
-    if (!outFile) {  // Check if the file was opened successfully
-        cout << "Error opening file for writing: " << filename << endl;
-        return;  // Exit the method if file opening fails
+    // Show the find bar over the top bar
+    if (findActive) {
+        sf::RectangleShape findBackground(sf::Vector2f(700.f, 30.f));
+        findBackground.setPosition(150.f, 15.f);
+        findBackground.setFillColor(sf::Color(230, 230, 230));
+        window.draw(findBackground);
+
+        // Number of the match under the cursor, if any
+        size_t cursor = cursorOffset();
+        size_t total = 0;
+        size_t current = 0;  // 1 for the first match, 0 when the cursor is not on a match
+        std::string more;    // Shown after the total when it is not final
+        if (regexMode) {
+            const std::vector<RegexSearch::Match>& matches = regexSearch.getMatches();
+            auto found = lower_bound(matches.begin(), matches.end(), cursor, [](const RegexSearch::Match& m, size_t o) { return m.offset < o; });
+            current = found != matches.end() && found->offset == cursor ? found - matches.begin() + 1 : 0;
+            total = regexSearch.foundCount();  // Counts the matches the worker has not handed over yet
+            more = regexSearch.isSearching() ? "+ (" + std::to_string(static_cast<int>(regexSearch.progress() * 100)) + "%)" : "";
+        } else {
+            const MatchList& matches = search.getMatches();
+            size_t found = matches.rank(cursor);
+            current = found < matches.size() && matches.at(found) == cursor ? found + 1 : 0;
+            total = matches.size();
+            more = search.isComplete() ? "" : "+";
+        }
+        std::string status = total == 0 && more.empty() ? "no matches"
+                           : current > 0 ? std::to_string(current) + " of " + std::to_string(total) + more
+                           : std::to_string(total) + more + " matches";
+        if (regexMode && regexSearch.skippedCount() > 0) {
+            status += " (" + std::to_string(regexSearch.skippedCount()) + " long lines not searched)";
+        }
+        if (regexMode && !regexSearch.isValid()) {
+            status = "invalid expression";
+        }
+        if (regexMode && regexSearch.isCut() && !regexSearch.isSearching()) {
+            // Ctrl+Enter replaces the kept matches, the search that follows it finds the others
+            status += " (Ctrl+Enter replaces the first " + std::to_string(regexSearch.getMatches().size()) + ")";
+        }
+        if (replacePending) {
+            status = "replacing when the search is done";
+        }
+        // The field that receives the typed text ends with the text cursor
+        std::string bar = std::string(regexMode ? "Regex: " : "Find: ") + findPattern + (replaceFocus ? "   " : "_   ");
+        if (replaceFocus || !replaceText.empty()) {
+            bar += "Replace: " + replaceText + (replaceFocus ? "_   " : "   ");
+        }
+        sf::Text findText;
+        findText.setFont(textRenderer.getFont());
+        findText.setString(bar + (findPattern.empty() ? "" : status));
+        findText.setCharacterSize(18);
+        findText.setFillColor(sf::Color::Black);
+        findText.setPosition(155.f, 18.f);
+        window.draw(findText);
+        drawCalls += 2;
     }
 
-    // Start with the first line (currentLine)
-    LineNode* node = currentLine;
-    while (node->prev) {
-        node = node->prev;  // Move to the first line in the linked list
+    // Show the goto-line prompt over the top bar
+    if (gotoLineActive) {
+        sf::RectangleShape promptBackground(sf::Vector2f(400.f, 30.f));
+        promptBackground.setPosition(150.f, 15.f);
+        promptBackground.setFillColor(sf::Color(230, 230, 230));
+        window.draw(promptBackground);
+
+        sf::Text promptText;
+        promptText.setFont(textRenderer.getFont());
+        promptText.setString("Go to line (1-" + std::to_string(document.lineCount()) + "): " + gotoLineInput + "_");
+        promptText.setCharacterSize(18);
+        promptText.setFillColor(sf::Color::Black);
+        promptText.setPosition(155.f, 18.f);
+        window.draw(promptText);
+        drawCalls += 2;
     }
 
-    // Write each line's content to the file
-    while (node) {
-        outFile << node->line << "\n";  // Write the line followed by a newline character
-        node = node->next;  // Move to the next line
+    // Render the cursor if it's visible and inside the viewport (the view may be scrolled sideways away from it)
+    if (cursorVisible && cursorLine >= firstLine && cursorLine < endLine && cursorColumn >= leftColumn) {
+        const std::vector<float>& advances = textRenderer.lineAdvances(cursorLine, cursorLineText);
+        if (cursorColumn - leftColumn < advances.size()) {
+            float cursorX = textRenderer.getTextX() + advances[cursorColumn - leftColumn];
+            float cursorY = TEXT_TOP + (cursorLine - firstLine) * LINE_HEIGHT;
+
+            // Create a rectangle shape to represent the cursor
+            sf::RectangleShape cursor(sf::Vector2f(2.f, 24.f));  // A vertical line as the cursor
+            cursor.setPosition(cursorX, cursorY);  // Position the cursor
+            cursor.setFillColor(sf::Color::Black);  // Set the cursor color
+            window.draw(cursor);  // Draw the cursor onto the window
+            drawCalls++;
+        }
     }
+}
 
-    outFile.close();  // Close the file after writing is done
-    cout << "File saved successfully as: " << filename << std::endl;
+// function to draw one line with sf::Text objects, the way every line used to be drawn
+void TextEditor::renderLineWithText(sf::RenderWindow& window, size_t lineIndex, const std::string& lineText, float y) {
+    // Render the line number
+    sf::Text lineNumberText;  // Create a text object to display the line number
+    lineNumberText.setFont(textRenderer.getFont());  // Set the font for the line number
+    lineNumberText.setString(std::to_string(lineIndex + 1));  // Convert line number to string
+    lineNumberText.setCharacterSize(CHARACTER_SIZE);  // Set the font size
+    lineNumberText.setFillColor(sf::Color::Blue);  // Set the text color for line numbers
+    lineNumberText.setPosition(TextRenderer::NUMBER_X, y);  // Position the line number
+    window.draw(lineNumberText);  // Draw the line number
+
+    // Render the actual line content
+    sf::Text text;  // Create a text object to display the current line
+    text.setFont(textRenderer.getFont());  // Set the font for the text
+    text.setString(lineText);  // Set the string to the content of the line
+    text.setCharacterSize(CHARACTER_SIZE);  // Set the font size for the text
+    text.setFillColor(sf::Color::Black);  // Set the text color to black
+    text.setPosition(textRenderer.getTextX(), y);  // Position the text on the screen (adjusted for line numbers)
+    window.draw(text);  // Draw the text onto the window
+    drawCalls += 2;
 }
 
-void TextEditor::readFromFile(const string& filename) {
-    clearstack();
-    std::ifstream file(filename, ios::in); // Open file in input mode
-    if (!file.is_open()) { // Check if file opened successfully
-        cerr << "Failed to open file: " << filename << std::endl;
-        return;
+// function to turn the syntax tokens of a line into the color runs of its visible columns
+void TextEditor::colorRuns(const std::vector<SyntaxHighlighter::Token>& tokens, size_t visible, std::vector<ColorRun>& runs) const {
+    // The tokens count columns from the start of the line, the runs from the first visible column
+    for (const SyntaxHighlighter::Token& token : tokens) {
+        size_t start = max(token.start, leftColumn);
+        size_t end = min(token.start + token.length, leftColumn + visible);
+        if (start < end) {
+            runs.push_back({start - leftColumn, end - start, TOKEN_COLORS[token.kind]});
+        }
+    }
+}
+
+// function to insert text in the document and keep the search matches up to date
+void TextEditor::insertText(size_t offset, const char* text, size_t count) {
+    // A line feed moves every line after it, otherwise only the edited line has to be measured again
+    size_t line = document.lineOfOffset(offset);
+    if (memchr(text, '\n', count)) {
+        textRenderer.invalidateLinesFrom(line);
+    } else {
+        textRenderer.invalidateLine(line);
+    }
+    preferredX = -1.f;
+    damaged = true;
+    size_t lines = document.lineCount();
+    document.insert(offset, text, count);
+    highlighter.onEdit(line, 0, document.lineCount() - lines);
+    recovery.logInsert(offset, text, count);
+    search.onInsert(document, offset, count);
+    regexStale = regexMode && !findPattern.empty();  // The regex worker searches a snapshot, it starts again next frame
+}
+
+// function to erase text from the document and keep the search matches up to date
+void TextEditor::eraseText(size_t offset, size_t count) {
+    size_t line = document.lineOfOffset(offset);
+    if (document.lineOfOffset(offset + count) != line) {
+        textRenderer.invalidateLinesFrom(line);
+    } else {
+        textRenderer.invalidateLine(line);
     }
+    preferredX = -1.f;
+    damaged = true;
+    size_t lines = document.lineCount();
+    document.erase(offset, count);
+    highlighter.onEdit(line, lines - document.lineCount(), 0);
+    recovery.logErase(offset, count);
+    search.onErase(document, offset, count);
+    regexStale = regexMode && !findPattern.empty();
+}
 
-    LineNode* prevLine = nullptr; // To keep track of the previous line for linking nodes
-    LineNode* firstLine = nullptr; // Pointer to the first line (root of the linked list)
-    char ch;
-    const size_t bufferSize = 128; // Initial buffer size (adjust as needed)
-    size_t bufferIndex = 0; // Current index in the buffer
-    char* lineBuffer = new char[bufferSize]; // Temporary buffer for line text
+// function to replace many ranges of the document at once and search the result again
+void TextEditor::replaceRanges(const std::vector<Replacement>& ranges, const std::string& texts) {
+    // The lines from the first range to the last one are lexed again
+    size_t line = 0;
+    size_t spanned = 0;
+    size_t lines = document.lineCount();
+    if (!ranges.empty()) {
+        line = document.lineOfOffset(ranges.front().position);
+        spanned = document.lineOfOffset(ranges.back().position + ranges.back().oldLength) - line;
+        textRenderer.invalidateLinesFrom(line);
+    }
+    preferredX = -1.f;
+    damaged = true;
+    document.replaceRanges(ranges, texts);
+    if (!ranges.empty()) {
+        highlighter.onEdit(line, spanned, spanned + document.lineCount() - lines);
+    }
+    recovery.logReplace(ranges, texts);
+    search.refresh(document);  // Cheaper than following every range: one scan at memory bandwidth
+    regexStale = regexMode && !findPattern.empty();
+}
 
-    if (!lineBuffer) {
-        cerr << "Failed to allocate memory for line buffer." << endl;
+// function to insert a whole text at the cursor, e.g. the clipboard
+// The piece table appends it to the add buffer once and indexes its line feeds in one scan, so a
+// paste of many megabytes costs about as much as copying it, and it is one undo step.
+void TextEditor::insertText(std::string_view text) {
+    damaged = true;
+    if (findActive) {
+        // The fields are a single line
+        std::string& field = replaceFocus ? replaceText : findPattern;
+        field.append(text.substr(0, text.find_first_of("\r\n")));
+        if (!replaceFocus) {
+            applyFindPattern();
+        }
+        return;
+    }
+    // Windows and old Mac line endings become '\n' (the text is only copied when there are some)
+    std::string normalized;
+    if (text.find('\r') != std::string_view::npos) {
+        normalized.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\r') {
+                normalized += text[i];
+            } else if (i + 1 >= text.size() || text[i + 1] != '\n') {
+                normalized += '\n';
+            }
+        }
+        text = normalized;
+    }
+    if (text.empty()) {
         return;
     }
 
-    // Read the file character by character
-    while (file.get(ch)) {
+    size_t offset = cursorOffset();
+    TRACE_INFO("paste: bytes", text.size());
+    insertText(offset, text.data(), text.size());
+    // Sealed on both sides so the paste is never merged with the typing around it
+    journal.seal();
+    journal.recordInsert(offset, std::string(text), offset, offset + text.size());
+    journal.seal();
+    setCursorOffset(offset + text.size());
+    scrollToCursor();
+}
 
-        if (ch == '\n' || bufferIndex == bufferSize - 1) { // End of line or buffer is full
-            LineNode* newLine = new LineNode(); // Create a new line node
+// function to replace every match of the find bar pattern with the replace field
+// The ranges are built in one walk over the matches and applied in one pass over the pieces,
+// and the whole batch is one REPLACE command in the journal.
+void TextEditor::replaceAll() {
+    if (findPattern.empty()) {
+        return;
+    }
+    std::vector<Replacement> ranges;
+    std::string removed;   // Replaced texts, one after the other
+    std::string inserted;  // New texts, one after the other
+    if (regexMode) {
+        regexSearch.poll();
+        if (!regexSearch.isValid()) {
+            return;
+        }
+        if (regexStale || !regexSearch.isComplete()) {
+            // update() calls this again when the search of the current text is over
+            replacePending = true;
+            return;
+        }
+        if (regexSearch.isCut()) {
+            // Only the kept matches are replaced; the search that follows finds the rest
+            TRACE_INFO("replace all: matches kept/found", regexSearch.getMatches().size(), regexSearch.foundCount());
+        }
+        std::string line;       // Line that holds the current match (a match never spans lines)
+        size_t lineOffset = 0;  // Document offset of that line
+        for (const RegexSearch::Match& match : regexSearch.getMatches()) {
+            if (match.offset >= lineOffset + line.size()) {
+                size_t number = document.lineOfOffset(match.offset);
+                lineOffset = document.lineStart(number);
+                line = document.getLine(number);  // Each line is read once, the matches are sorted
+            }
+            std::string matchText = line.substr(match.offset - lineOffset, match.length);
+            std::string text = regexSearch.format(line, lineOffset, match, replaceText);  // Expands $& and $1 to $9
+            if (text != matchText) {
+                ranges.push_back(Replacement{match.offset, matchText.size(), text.size()});
+                removed += matchText;
+                inserted += text;
+            }
+        }
+    } else if (replaceText != findPattern) {
+        std::vector<size_t> starts;
+        search.nonOverlapping(document, starts);
+        ranges.reserve(starts.size());
+        for (size_t start : starts) {
+            ranges.push_back(Replacement{start, findPattern.size(), replaceText.size()});
+            removed += findPattern;
+            inserted += replaceText;
+        }
+    }
+    if (ranges.empty()) {
+        return;
+    }
 
-            // Null-terminate the buffer and copy its content to the new line
-            lineBuffer[bufferIndex] = '\0';
-            newLine->line = new char[bufferIndex + 1];
-            std::copy(lineBuffer, lineBuffer + bufferIndex + 1, newLine->line);
+    // The cursor stays in the same place of the text around it
+    size_t before = cursorOffset();
+    size_t after = before;
+    for (const Replacement& range : ranges) {
+        if (range.position >= before) {
+            break;
+        }
+        if (range.position + range.oldLength > before) {
+            after = after - (before - range.position) + range.newLength;  // Inside a range: go to the end of its new text
+            break;
+        }
+        after = after - range.oldLength + range.newLength;
+    }
 
-            newLine->length = bufferIndex; // Set the line length
-            newLine->cursorPos = 0; // Initialize cursor position to the start of the line
-    
+    TRACE_INFO("replace all: ranges/bytes", ranges.size(), inserted.size());
+    replaceRanges(ranges, inserted);
+    journal.recordReplace(std::move(ranges), std::move(removed), std::move(inserted), before, after);
+    setCursorOffset(after);
+    scrollToCursor();
+}
 
-            // Link the new line into the linked list
-            if (prevLine) {
-                prevLine->next = newLine;
-                newLine->prev = prevLine;
+// function to handle an event while the find bar is open, returns true when the find bar used it
+bool TextEditor::handleFindInput(const sf::Event& event) {
+    if (event.type == sf::Event::TextEntered) {
+        uint32_t unicode = event.text.unicode;
+        std::string& field = replaceFocus ? replaceText : findPattern;
+        if (unicode >= 32 && unicode <= 126) {
+            field += static_cast<char>(unicode);
+        } else if (unicode == '\b' && !field.empty()) {
+            field.pop_back();
+        } else {
+            return true;  // Enter is handled as a key press, other control characters are ignored
+        }
+        if (!replaceFocus) {
+            applyFindPattern();
+        }
+        return true;
+    }
+
+    if (event.type == sf::Event::KeyPressed) {
+        // Escape closes the find bar and removes the highlights
+        if (event.key.code == sf::Keyboard::Escape) {
+            findActive = false;
+            findPattern.clear();
+            search.clear();
+            regexSearch.clear();
+            findJumpPending = false;
+            replaceFocus = false;
+            replacePending = false;
+            return true;
+        }
+        // Tab moves the typing between the find and the replace fields
+        if (event.key.code == sf::Keyboard::Tab) {
+            replaceFocus = !replaceFocus;
+            return true;
+        }
+        // Ctrl+Enter replaces every match
+        if (event.key.code == sf::Keyboard::Enter && event.key.control) {
+            replaceAll();
+            return true;
+        }
+        // Ctrl+R switches between literal and regular expression search
+        if (event.key.code == sf::Keyboard::R && event.key.control) {
+            regexMode = !regexMode;
+            search.clear();
+            regexSearch.clear();
+            applyFindPattern();
+            return true;
+        }
+        // Enter goes to the next match, Shift+Enter to the previous one
+        if (event.key.code == sf::Keyboard::Enter) {
+            size_t match = 0;
+            bool found = false;
+            if (regexMode) {
+                RegexSearch::Match regexMatch;
+                found = event.key.shift ? regexSearch.previous(cursorOffset(), regexMatch) : regexSearch.next(cursorOffset() + 1, regexMatch);
+                match = regexMatch.offset;
+                findJumpPending = false;
             } else {
-                firstLine = newLine; // Set as the first line if this is the start
+                found = event.key.shift ? search.previous(cursorOffset(), match) : search.next(cursorOffset() + 1, match);
+            }
+            if (found) {
+                journal.seal();
+                setCursorOffset(match);
+                findOrigin = match;
             }
+            return true;
+        }
+    }
+    return false;  // Cursor keys, undo and the other shortcuts keep working
+}
 
-            prevLine = newLine; // Move to the newly created line
-            bufferIndex = 0; // Reset the buffer index for the next line
-    
-        } else {
-            lineBuffer[bufferIndex++] = ch; // Add character to the buffer
-    
+// function to search for the pattern of the find bar, in the current mode
+void TextEditor::applyFindPattern() {
+    if (regexMode) {
+        // The regex search runs on a worker; update() moves the cursor when the first match comes in
+        regexSearch.start(document, findPattern);
+        regexStale = false;
+        findJumpPending = !findPattern.empty();
+        return;
+    }
+    // Incremental search: every keystroke narrows the matches and shows the first one after the search origin
+    search.setPattern(document, findPattern);
+    size_t match;
+    if (search.next(findOrigin, match)) {
+        journal.seal();
+        setCursorOffset(match);
+    }
+}
 
-            // Resize the buffer if necessary
-            if (bufferIndex >= bufferSize - 1) {
-                size_t newBufferSize = bufferSize * 2;
-                char* newBuffer = new char[newBufferSize];
-                copy(lineBuffer, lineBuffer + bufferSize, newBuffer);
-                delete[] lineBuffer; // Free the old buffer
-                lineBuffer = newBuffer;
-        
-                // Update the buffer size
+// function to build the highlight quads of the matches inside one visible line
+void TextEditor::addMatchQuads(size_t lineIndex, const std::string& lineText, float y) {
+    if (findPattern.empty()) {
+        return;
+    }
+    // Only the visible columns of the line are in lineText
+    size_t start = document.lineStart(lineIndex) + leftColumn;
+    size_t end = start + lineText.size();
+    size_t cursor = cursorOffset();
+
+    // Adds the quad of one match that starts at offset, cut to the visible columns
+    // Every match given to it ends after start.
+    auto addQuad = [&](size_t offset, size_t length) {
+        size_t column = max(offset, start) - start;
+        size_t last = min(offset + length, end) - start;
+        if (last <= column) {
+            return;  // A match of a line feed at the end of the line has nothing to cover
+        }
+        const std::vector<float>& advances = textRenderer.lineAdvances(lineIndex, lineText);
+        float x0 = textRenderer.getTextX() + advances[column];
+        float x1 = textRenderer.getTextX() + advances[last];
+        // The match under the cursor is orange, the others yellow
+        sf::Color color = offset == cursor ? sf::Color(255, 150, 0, 110) : sf::Color(255, 230, 0, 110);
+        sf::Vector2f corners[4] = {sf::Vector2f(x0, y), sf::Vector2f(x1, y), sf::Vector2f(x1, y + LINE_HEIGHT), sf::Vector2f(x0, y + LINE_HEIGHT)};
+        int order[6] = {0, 1, 2, 0, 2, 3};
+        for (int corner : order) {
+            matchQuads.append(sf::Vertex(corners[corner], color, sf::Vector2f()));
+        }
+    };
+
+    if (regexMode) {
+        const std::vector<RegexSearch::Match>& matches = regexSearch.getMatches();
+        auto match = lower_bound(matches.begin(), matches.end(), start, [](const RegexSearch::Match& m, size_t o) { return m.offset < o; });
+        if (match != matches.begin() && (match - 1)->offset + (match - 1)->length > start) {
+            --match;  // A match that starts left of the visible columns and reaches into them
+        }
+        for (; match != matches.end() && match->offset <= end; ++match) {
+            addQuad(match->offset, match->length);
+        }
+    } else {
+        const MatchList& matches = search.getMatches();
+        size_t first = start - min(start, findPattern.size() - 1);  // Matches that start left of the visible columns
+        for (size_t match = matches.rank(first); match < matches.size() && matches.at(match) <= end; ++match) {
+            addQuad(matches.at(match), findPattern.size());
+        }
+    }
+}
+
+// function to move the cursor to the start of a line (counting from 0) and show it in the middle of the viewport
+// The piece table finds the line from the line feed counts cached in its tree, so the jump is O(log n) whatever the line
+void TextEditor::gotoLine(size_t line) {
+    journal.seal();  // Typing after the jump starts a new undo step
+    cursorLine = min(line, document.lineCount() - 1);
+    cursorColumn = 0;
+    preferredX = -1.f;
+    setLeftColumn(0);
+    topLine = cursorLine > visibleLines / 2 ? cursorLine - visibleLines / 2 : 0;
+    TRACE_DEBUG("goto line", cursorLine);
+}
+
+// function to handle the keys typed while the goto-line prompt is open
+void TextEditor::handleGotoLineInput(const sf::Event& event) {
+    if (event.type == sf::Event::TextEntered) {
+        uint32_t unicode = event.text.unicode;
+        if (unicode >= '0' && unicode <= '9' && gotoLineInput.size() < 19) {
+            gotoLineInput += static_cast<char>(unicode);  // Only digits make a line number
+        } else if (unicode == '\b' && !gotoLineInput.empty()) {
+            gotoLineInput.pop_back();
+        } else if (unicode == '\r' || unicode == '\n') {
+            // Line numbers are shown starting from 1
+            if (!gotoLineInput.empty()) {
+                size_t line = stoull(gotoLineInput);
+                gotoLine(line > 0 ? line - 1 : 0);
             }
+            gotoLineActive = false;
         }
+    } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape) {
+        gotoLineActive = false;  // Close the prompt without moving
+    }
+}
+
+// function to know which render path is active
+bool TextEditor::isBatchedRendering() const {
+    return batchedRendering;
+}
+
+bool TextEditor::isLoading() const {
+    return document.isLoading();
+}
+
+// functions to read the counters shown by the instrumentation overlay
+unsigned TextEditor::getDrawCalls() const {
+    return drawCalls;
+}
+
+size_t TextEditor::lineCount() const {
+    return document.lineCount();
+}
+
+size_t TextEditor::documentBytes() const {
+    return document.length();
+}
+
+// Function to get the number of bytes used by the undo history
+size_t TextEditor::undoMemoryUsage() const {
+    return journal.memoryUsage();
+}
+
+// Function to change the memory limit of the undo history
+void TextEditor::setUndoMemoryLimit(size_t bytes) {
+    journal.setMemoryLimit(bytes);
+}
+
+
+void TextEditor::saveToFile(const std::string& filename) {
+    // Saving now would write only the part of the file that has been opened so far
+    if (document.isLoading()) {
+        cout << "The file is still loading, wait for it to finish before saving" << endl;
+        return;
     }
 
-    // Handle the last line if the file does not end with a newline
-    if (bufferIndex > 0) {
-        LineNode* newLine = new LineNode();
-        // Null-terminate the buffer and copy its content to the new line
-        lineBuffer[bufferIndex] = '\0';
-        newLine->line = new char[bufferIndex + 1];
-        copy(lineBuffer, lineBuffer + bufferIndex + 1, newLine->line);
+    // The document is written from a snapshot by a worker thread, so the editor keeps running during the save;
+    // update() reports the result when the file is on disk
+    if (!saver.start(document, filename)) {
+        cout << "A save is still running, wait for it to finish before saving again" << endl;
+        return;
+    }
+    saveMark = recovery.mark();  // The edits journaled from here on are not in the saved file
+    TRACE_INFO("save: started, bytes", document.length() + 1);
+}
 
-        newLine->length = bufferIndex;
-        newLine->cursorPos = 0;
-        // Link the last line into the linked list
-        if (prevLine) {
-            prevLine->next = newLine;
-            newLine->prev = prevLine;
+// function to print the outcome of a background save and compact the recovery journal
+void TextEditor::finishSave(const SaveResult& saved) {
+    if (!saved.success) {
+        cout << "Error saving file: " << saved.filename << " (" << saved.error << ")" << endl;
+        return;
+    }
+    // The saved file is the new starting point of a recovery: only the edits made since the snapshot are kept
+    if (saveMark != NO_SAVE_MARK) {
+        recovery.rebase(saved.filename, saveMark);
+    }
+    double megabytes = saved.bytes / (1024.0 * 1024.0);
+    cout << "File saved successfully as: " << saved.filename << " (" << megabytes << " MB in " << saved.seconds * 1000
+         << " ms, " << (saved.seconds > 0 ? megabytes / saved.seconds : 0) << " MB/s)" << endl;
+}
+
+// function to know whether the document is still being saved
+bool TextEditor::isSaving() const {
+    return saver.isSaving();
+}
+
+// function to know whether a regex search or a replace-all waiting for it is still running
+bool TextEditor::isSearching() const {
+    return regexMode && (regexSearch.isSearching() || regexStale || replacePending);
+}
+
+// function to journal the edits, after replaying the ones a crashed session left
+bool TextEditor::startRecovery(const string& journalFile) {
+    JournalContents contents;
+    if (!RecoveryJournal::read(journalFile, contents) || contents.edits.empty()) {
+        recovery.open(journalFile);  // Nothing to recover
+        return false;
+    }
+
+    // The journal was not deleted, so the last session did not close normally
+    string base = contents.baseFile.empty() ? "a new document" : contents.baseFile;
+    cout << "Recovering " << contents.edits.size() << " unsaved edits of " << base << endl;
+    error_code error;
+    bool baseFound = contents.baseFile.empty() || (filesystem::file_size(contents.baseFile, error) == contents.baseSize && !error);
+    if (baseFound && replayJournal(contents)) {
+        recovery.open(journalFile, &contents);  // The new edits are journaled after the replayed ones
+        return true;
+    }
+
+    // The base file changed since the crash; the journal is kept aside rather than replayed onto the wrong text
+    filesystem::rename(journalFile, journalFile + ".unrecovered", error);
+    cerr << "The unsaved edits do not match " << base << ", they are kept in " << journalFile << ".unrecovered" << endl;
+    recovery.open(journalFile);
+    if (baseFound && !contents.baseFile.empty()) {
+        recovery.rebase(contents.baseFile, recovery.mark());  // The base file is open
+    }
+    return false;
+}
+
+// function to open the base file of a journal and apply its edits in order
+bool TextEditor::replayJournal(const JournalContents& contents) {
+    // The base file is indexed right away: the edits need the whole of it, and no frame is drawn before they are applied
+    if (!contents.baseFile.empty() && !openDocument(contents.baseFile, false)) {
+        return false;
+    }
+
+    // Every edit must fit the document it was made on; one that does not means the base file is not the same
+    size_t length = document.length();
+    for (const JournalEdit& edit : contents.edits) {
+        if (edit.op == Command::ADD) {
+            if (edit.position > length) {
+                return false;
+            }
+            length += edit.text.size();
+        } else if (edit.op == Command::DELETE) {
+            if (edit.length > length || edit.position > length - edit.length) {
+                return false;
+            }
+            length -= edit.length;
         } else {
-            // Set as the first line if this is the start
-            firstLine = newLine;
+            // The ranges are sorted, do not overlap, and their offsets are from before the batch
+            size_t end = 0;
+            size_t oldLength = 0;
+            size_t newLength = 0;
+            for (const Replacement& range : edit.ranges) {
+                if (range.position < end || range.oldLength > length || range.position > length - range.oldLength) {
+                    return false;
+                }
+                end = range.position + range.oldLength;
+                oldLength += range.oldLength;
+                newLength += range.newLength;
+            }
+            if (newLength != edit.text.size()) {
+                return false;
+            }
+            length = length - oldLength + newLength;
         }
     }
-    delete[] lineBuffer; // Free the temporary buffer
-    file.close(); // Close the file
 
-    // Set the editor's current line to the first line
-    currentLine = firstLine;
+    size_t cursor = 0;
+    for (const JournalEdit& edit : contents.edits) {
+        if (edit.op == Command::ADD) {
+            insertText(edit.position, edit.text.data(), edit.text.size());
+            cursor = edit.position + edit.text.size();
+        } else if (edit.op == Command::DELETE) {
+            eraseText(edit.position, edit.length);
+            cursor = edit.position;
+        } else {
+            replaceRanges(edit.ranges, edit.text);
+            cursor = edit.ranges.empty() ? cursor : edit.ranges.front().position;
+        }
+    }
+    setCursorOffset(cursor);  // At the last edit, where the user was working
+    scrollToCursor();
+    return true;
+}
+
+void TextEditor::readFromFile(const string& filename) {
+    // The line feeds are counted by a worker thread and update() adds the counted part to the document every frame
+    openDocument(filename, true);
+}
+
+// function to open a file as the document and reset everything that belonged to the previous one
+bool TextEditor::openDocument(const string& filename, bool background) {
+    // Map the file read-only; nothing is copied and the lines are only read when they are shown or edited
+    // A save that is still running goes on: its snapshot keeps the previous file mapped until it is written
+    regexSearch.clear();  // The matches belong to the previous document
+    if (!document.open(filename, background)) { // Check if file opened successfully
+        cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    recovery.rebase(filename, recovery.mark());  // The edits of the previous file are not needed any more
+    saveMark = NO_SAVE_MARK;  // ... and neither is the file a running save writes
+    highlighter.setLanguage(filename);  // The first pass starts once the file is fully open
+    clearstack();
+    textRenderer.invalidateLinesFrom(0);
+    search.clear();
+    findActive = false;
+    findPattern.clear();
+    findJumpPending = false;
+    replaceFocus = false;
+    replacePending = false;
+
+    // Set the editor's cursor to the start of the first line
+    cursorLine = 0;
+    cursorColumn = 0;
+    preferredX = -1.f;
+    topLine = 0;
+    leftColumn = 0;
+    damaged = true;
+    return true;
 }
 
 
 void TextEditor::moveCursorUp() {
-    if (currentLine->prev != nullptr) {
-        // Move to the previous line
-        currentLine->prev->cursorPos = currentLine->cursorPos;
-        currentLine = currentLine->prev;
+    if (cursorLine > 0) {
+        journal.seal();  // Moving the cursor ends the current typing run
 
-        Command cmd;
-        cmd.setCursorCommand(Command::CursorUp);
-        undoStack.push(cmd);
+        // Move to the previous line, keeping the x position when the line is long enough
+        moveCursorToLine(cursorLine - 1);
 
         // Debugging: Log current line state
-        cout << "\nMoved cursor up. Current line: " << currentLine->line 
-             << "\nCursor position: " << currentLine->cursorPos << "\n";
+        TRACE_DEBUG("cursor up: line/column", cursorLine, cursorColumn);
     } else {
-        cout << "\nNo previous line\n"; // Debugging output
+        TRACE_DEBUG("cursor up: no previous line"); // Debugging output
     }
 }
 
 void TextEditor::moveCursorDown() {
-    if (currentLine->next != nullptr) {
-        // Move to the next line
-        currentLine->next->cursorPos = currentLine->cursorPos;
-        currentLine = currentLine->next;
+    if (cursorLine + 1 < document.lineCount()) {
+        journal.seal();  // Moving the cursor ends the current typing run
 
-        Command cmd;
-        cmd.setCursorCommand(Command::CursorDown);
-        undoStack.push(cmd);
+        // Move to the next line, keeping the x position when the line is long enough
+        moveCursorToLine(cursorLine + 1);
 
         // Debugging: Log current line state
-        cout << "\nMoved cursor down. Current line: " << currentLine->line << "\nCursor position: " << currentLine->cursorPos << "\n";
+        TRACE_DEBUG("cursor down: line/column", cursorLine, cursorColumn);
     } else {
-        cout << "\nNo next line\n"; // Debugging output
+        TRACE_DEBUG("cursor down: no next line"); // Debugging output
     }
 }
-void TextEditor::UpdateLineNumber() {
-    //generate a funcnction to update the line number like it should increment the line number by 1
-
-    LineNode* node = head;
-    int number = 0;
-    while (node != nullptr) { 
-        node->lineNumber = number++;
-        node = node->next;
-    }
-    // Debugging: Log current line state
-    cout << "\nUpdated line numbers. Current line: " << currentLine->line << "\nCursor position: " << currentLine->cursorPos << "\n";
-    // Debugging output
-    
-}
 
 void TextEditor::moveCursorLeft() {
-    if (currentLine->cursorPos == 0) {
-        cout << "\nCursor position is 0 now\n"; // Debugging output
-        if (currentLine->prev != nullptr) {
-            currentLine = currentLine->prev;
-            currentLine->cursorPos = currentLine->length;
-
-            Command cmd;
-            cmd.setCursorCommand(Command::CursorLeft);
-            undoStack.push(cmd);
+    preferredX = -1.f;  // A horizontal move picks a new x for the next vertical moves
+    if (cursorColumn == 0) {
+        TRACE_DEBUG("cursor left: at column 0, line", cursorLine); // Debugging output
+        if (cursorLine > 0) {
+            journal.seal();  // Moving the cursor ends the current typing run
+
+            cursorLine--;
+            cursorColumn = document.lineLength(cursorLine);
     
             // Debugging: Log current line state
-            cout << "\nMoved cursor to the previous line. Current line: " << currentLine->line << "\nCursor position: " << currentLine->cursorPos << "\n";
+            TRACE_DEBUG("cursor left: previous line, line/column", cursorLine, cursorColumn);
         } else {
-            cout << "\nNo previous line available to move left\n"; // Debugging output
+            TRACE_DEBUG("cursor left: no previous line"); // Debugging output
         }
     } else {
-        currentLine->moveCursorLeft();
+        journal.seal();  // Moving the cursor ends the current typing run
+
+        cursorColumn--;
         // Debugging: Log state after moving within the current line
-        cout << "\nMoved cursor left. Current cursor position: " << currentLine->cursorPos << "\n"; // Debugging
+        TRACE_DEBUG("cursor left: line/column", cursorLine, cursorColumn); // Debugging
     }
 }
 
 void TextEditor::moveCursorRight() {
+    preferredX = -1.f;  // A horizontal move picks a new x for the next vertical moves
     // Check if the cursor is at the end of the current line
-    if (currentLine->cursorPos == currentLine->length) {
+    if (cursorColumn == document.lineLength(cursorLine)) {
         // Move to the next line
-        if (currentLine->next != nullptr) {
-            currentLine = currentLine->next;
-            currentLine->cursorPos = 0;
+        if (cursorLine + 1 < document.lineCount()) {
+            journal.seal();  // Moving the cursor ends the current typing run
 
-            Command cmd;
-            cmd.setCursorCommand(Command::CursorRight);
-            undoStack.push(cmd);
+            cursorLine++;
+            cursorColumn = 0;
 
             // Debugging: Log state after moving to next line
-            cout << "\nMoved cursor to the next line. Current line: " << currentLine->line << "\nCursor position: " << currentLine->cursorPos << "\n";
+            TRACE_DEBUG("cursor right: next line, line/column", cursorLine, cursorColumn);
         } else {
-            cout << "\nNo next line to move right\n"; // Debugging output
+            TRACE_DEBUG("cursor right: no next line"); // Debugging output
             return;
         }
     } else {
-        currentLine->moveCursorRight();
+        journal.seal();  // Moving the cursor ends the current typing run
+
+        cursorColumn++;
         // Debugging: Log state after moving within the current line
-        cout << "\nMoved cursor right. Current cursor position: " << currentLine->cursorPos << "\n";
+        TRACE_DEBUG("cursor right: line/column", cursorLine, cursorColumn);
     }
 }
@@ -4,64 +4,63 @@
 #include <SFML/Graphics.hpp>  // Include for graphical components (like rendering text, shapes, etc.)
 #include <SFML/Window.hpp>    // Include for handling window events and input
 #include <iostream>            // Include for input/output operations
-#include <stack>               // Include for stack data structure used for undo functionality
-
-// Command struct to store operations
-// This struct is used to store the type of operation (ADD, DELETE, NEXTLINE) 
-// and the associated character that is part of that operation
-struct Command {
-    enum Operation { ADD, DELETE, NEXTLINE ,CursorLeft,CursorRight,CursorUp,CursorDown} op; // Enum for command operations
-    char text; // Character associated with the operation (e.g., the added or deleted character)
-
-    // Function to set the command's operation and text
-    void setCommand(Operation operation, char character);
-    void setCursorCommand(Operation Operation);
-};
-
-// LineNode class to represent a line of text
-// Each line of text is stored as a linked list node. The class holds the data for one line, 
-// along with pointers to the next and previous lines, facilitating navigation through the text.
-class LineNode {
-    public:
-    char* line;           // A dynamic array to store characters in the line of text
-    size_t capacity;      // Maximum capacity of the line (allocated memory size)
-    size_t length;        // Current number of characters in the line
-    size_t cursorPos;     // The position of the cursor within the line
-    LineNode* prev;       // Pointer to the previous line node
-    LineNode* next;       // Pointer to the next line node
-    int lineNumber;
-
-    // Constructor to initialize a LineNode with a specified capacity (default 128)
-    LineNode(size_t cap =128);
-    // Destructor to clean up the dynamic memory used by the line
-    ~LineNode();
-    // Method to append a character to the line
-    void appendChar(char c);
-    // Method to remove the character at the current cursor position
-    void removeChar();
-    // Method to resize the line's storage capacity
-    void resize(size_t newCapacity);
-    // Methods to move the cursor left and right within the line
-    void moveCursorLeft();
-    void moveCursorRight();
-    void moveCursorUp();
-    void moveCursorDown();
-};
+#include <string_view>         // Include for the text given to the bulk insert
+#include "undoJournal.h"       // Include for the undo and redo history
+#include "pieceTable.h"        // Include for the piece table that stores the document
+#include "textRenderer.h"      // Include for the batched glyph renderer
+#include "documentSearch.h"    // Include for the find bar matches
+#include "regexSearch.h"       // Include for the background regex search
+#include "fileSaver.h"         // Include for the background save
+#include "recoveryJournal.h"   // Include for the crash recovery journal
+#include "syntaxHighlighter.h" // Include for the syntax colors of source files
+#include "trace.h"             // Include for the debug trace ring buffer
 
 // TextEditor class to handle input, update, render, and undo operations
 // This class represents the notepad's main functionality, including handling user input,
 // updating the editor state, rendering the text on the screen, and performing undo operations.
 class TextEditor {
 private:
-    LineNode* currentLine; // Pointer to the current line where text is being typed
-    LineNode* head;
-    sf::Font font;         // Font used for rendering text
+    PieceTable document;   // Piece table holding the text of every line
+    UndoJournal journal;   // Undo and redo history of the document
+    size_t cursorLine;     // Line where the cursor is (starting from 0)
+    size_t cursorColumn;   // Position of the cursor within that line
+    float preferredX;      // x position kept while moving up and down through shorter lines, negative when unset
+    size_t topLine;        // First line shown at the top of the viewport
+    size_t leftColumn;     // First column shown at the left of the text area (horizontal scroll)
+    float textWidth;       // Width of the text area (updated on every render)
+    size_t visibleLines;   // Number of lines that fit in the window (updated on every render)
+    TextRenderer textRenderer; // Glyph atlas renderer that owns the font used for rendering text
+    bool batchedRendering; // True to draw with the glyph atlas, false for the old sf::Text path (toggled with F2)
     sf::Clock clock;       // Clock used to control timing (e.g., blinking cursor)
     bool cursorVisible;    // Boolean to manage cursor visibility (for blinking cursor)
+    bool focused;          // True while the window has the keyboard focus (the cursor only blinks then)
+    bool shiftHeld;        // True while a Shift key is down, followed from the key events so a replay sees it too
+    bool damaged;          // True when something shown on screen changed since the last render
+    bool workShown;        // True when the last update had a load or a search running (its progress is shown)
+    unsigned drawCalls;    // Number of draw calls issued by the last render
+    bool gotoLineActive;   // True while the goto-line prompt (Ctrl+G) is open
+    std::string gotoLineInput; // Digits typed in the goto-line prompt
+    DocumentSearch search; // Matches of the find bar pattern (Ctrl+F)
+    RegexSearch regexSearch; // Matches of the find bar pattern in regex mode, found by a worker thread
+    bool findActive;       // True while the find bar is open
+    std::string findPattern; // Pattern typed in the find bar
+    size_t findOrigin;     // Offset the incremental search starts from
+    bool regexMode;        // True when the find bar pattern is a regular expression (Ctrl+R)
+    bool regexStale;       // True when the document changed since the regex search started
+    bool findJumpPending;  // True until the cursor moved to the first regex match after the origin
+    std::string replaceText; // Text typed in the replace field of the find bar
+    bool replaceFocus;     // True when the typed text goes to the replace field (Tab switches)
+    bool replacePending;   // True while a regex replace-all waits for the search to finish
+    sf::VertexArray matchQuads; // Highlight quads of the matches in the viewport, rebuilt every frame
+    FileSaver saver;       // Writes the document to disk on a worker thread (Ctrl+S)
+    RecoveryJournal recovery; // Log of the unsaved edits, replayed after a crash (only when startRecovery was called)
+    size_t saveMark;       // Position of the recovery journal when the running save took its snapshot
+    SyntaxHighlighter highlighter; // Lexer states of every line, to color source files (chosen by extension)
 
 public:
     // Constructor to initialize the text editor and the initial line
-    TextEditor();
+    // Pass false to skip loading the font when the editor is driven without a window
+    explicit TextEditor(bool loadFont = true);
     // Destructor to clean up allocated memory and resources
     ~TextEditor();
 
@@ -69,10 +68,19 @@ public:
     void handleInput(sf::Event& event);
     // Method to update the editor (e.g., move cursor, handle time)
     void update();
+    // Method to know whether the screen must be drawn again (set by input, edits, the blink and background work)
+    bool needsRedraw() const;
+    // Method to get how long the editor can wait for an event before update() has something to do
+    // It returns 0 while a file is loading or a search is running, and -1 when only an event can change anything.
+    int millisecondsUntilChange() const;
+    // Method to tell the editor whether the window has the focus; without it the cursor stops blinking
+    void setFocused(bool hasFocus);
     // Method to render the text editor (draw text and cursor on the window)
     void render(sf::RenderWindow& window);
     // Method to perform an undo operation (reverts the last change)
     void undo();
+    // Method to perform a redo operation (applies the last undone change again)
+    void redo();
     // Method to save text to a
     void saveToFile(const std::string& filename);
     // method to read from a .txt file
@@ -85,10 +93,79 @@ public:
     void moveCursorLeft();
     // method to move the cursor right through right key press
     void moveCursorRight();
-    // method to update line number
-    void UpdateLineNumber(); 
-    // method to clear the undo stack before we load a new file to start from the begining, and put nothing in the undo stack.
+    // method to clear the undo history before we load a new file to start from the begining, and put nothing in the undo history.
     void clearstack();
+    // method to scroll the viewport by a number of lines (negative scrolls up)
+    void scrollBy(long lines);
+    // method to move the cursor to the start of a line (counting from 0), in O(log n)
+    void gotoLine(size_t line);
+    // method to replace every match of the find bar pattern with the replace field, as one undo step
+    void replaceAll();
+    // method to insert text at the cursor as one undo step (used by Ctrl+V; line endings become '\n')
+    // While the find bar is open the first line of the text goes to its focused field instead.
+    void insertText(std::string_view text);
+    // method to know which render path is active (used for frame time comparisons)
+    bool isBatchedRendering() const;
+    // method to know whether a file is still being opened in the background
+    bool isLoading() const;
+    // method to know whether the document is still being saved in the background
+    bool isSaving() const;
+    // method to know whether a regex search, or a replace-all waiting for it, is still running
+    bool isSearching() const;
+    // method to journal every edit to a file, so it can be recovered after a crash
+    // When the file is left over from a session that did not close normally, its base file is opened
+    // and its edits are replayed first; it returns true then. The journal is deleted when the editor closes.
+    bool startRecovery(const std::string& journalFile);
+    // methods to read the counters of the instrumentation overlay
+    unsigned getDrawCalls() const;
+    size_t lineCount() const;
+    size_t documentBytes() const;
+    size_t undoMemoryUsage() const;
+    // method to change how many bytes of undo history are kept (64 MB by default), dropping the oldest if needed
+    void setUndoMemoryLimit(size_t bytes);
+
+    static const char* const SAVE_FILE; // File written by Ctrl+S
+
+private:
+    // method to get the document offset of the cursor
+    size_t cursorOffset() const;
+    // method to place the cursor at a document offset
+    void setCursorOffset(size_t offset);
+    // method to move the cursor to another line at the x position it had before the vertical moves started
+    void moveCursorToLine(size_t line);
+    // method to open a file as the document, in the background or right away, returns false when it cannot be opened
+    bool openDocument(const std::string& filename, bool background);
+    // method to open the base file of a recovery journal and replay its edits, returns false when they do not fit it
+    bool replayJournal(const JournalContents& contents);
+    // method to get the x position of every visible column of a line (measured once, until the line is edited)
+    const std::vector<float>& lineAdvances(size_t line);
+    // methods to get the part of a line inside the visible columns, so long lines are never copied whole
+    size_t visibleLength(size_t line) const;
+    std::string visibleText(size_t line) const;
+    // method to scroll the view horizontally
+    void setLeftColumn(size_t column);
+    // method to get the first visible column that puts the end of the longest visible line at the right edge
+    size_t lastLeftColumn() const;
+    // method to scroll just enough to bring the cursor line into the viewport
+    void scrollToCursor();
+    // method to handle the keys typed while the goto-line prompt is open
+    void handleGotoLineInput(const sf::Event& event);
+    // method to handle an event while the find bar is open (returns false for the keys it does not use)
+    bool handleFindInput(const sf::Event& event);
+    // method to search for the find bar pattern in the current mode
+    void applyFindPattern();
+    // method to add the highlight quads of the matches inside one visible line
+    void addMatchQuads(size_t lineIndex, const std::string& lineText, float y);
+    // method to turn the syntax tokens of a line into the color runs of its visible columns
+    void colorRuns(const std::vector<SyntaxHighlighter::Token>& tokens, size_t visible, std::vector<ColorRun>& runs) const;
+    // methods to edit the document; every edit goes through them so the search matches stay up to date
+    void insertText(size_t offset, const char* text, size_t count);
+    void eraseText(size_t offset, size_t count);
+    void replaceRanges(const std::vector<Replacement>& ranges, const std::string& texts);
+    // method to print the outcome of a background save and drop the saved edits from the recovery journal
+    void finishSave(const SaveResult& saved);
+    // method to draw one visible line with sf::Text objects (the old path, kept for comparison)
+    void renderLineWithText(sf::RenderWindow& window, size_t lineIndex, const std::string& lineText, float y);
 
 };
 
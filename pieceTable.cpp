@@ -0,0 +1,630 @@
+#include    "pieceTable.h" // Include the header file for the piece table
+#include    <algorithm>    // For lower_bound when searching the newline indexes
+#include    "textScan.h"   // For the vectorized newline kernels
+#include    <cstdint>      // For the 64 bit hash of the node priorities
+#include    <cstring>      // For memcpy into the add buffer
+using namespace std; // Use the standard namespace for convenience
+
+// Size of a block of the add buffer; an insertion that does not fit in the last block starts a new one
+const size_t ADD_BLOCK = 1 << 20;
+
+// Constructor to create an empty document with no pieces
+PieceTable::PieceTable() : original(nullptr), originalSize(0), loadedSize(0), loadedLineFeeds(0), addedSize(0), addedCapacity(0), sharedAdded(0), root(nullptr), typingEnd(0) {}
+
+// Destructor to free every node of the tree
+PieceTable::~PieceTable() {
+    nodes.releaseAll();  // Frees the slabs, without walking the tree
+}
+
+// Function to replace the whole document with a new original buffer
+void PieceTable::load(string text) {
+    mappedOriginal.reset();
+    ownedOriginal = make_shared<string>(std::move(text));  // The loaded text becomes the immutable original buffer
+    original = ownedOriginal->data();
+    originalSize = ownedOriginal->size();
+    resetPieces(false);
+}
+
+// Function to replace the whole document with a memory mapped file
+bool PieceTable::open(const string& filename, bool background) {
+    shared_ptr<MappedFile> mapping = make_shared<MappedFile>();
+    if (!mapping->open(filename)) {
+        return false;  // Keep the current document when the file cannot be mapped
+    }
+    originalBreaks.cancel();  // The previous file may still be indexed in the background
+
+    // The previous file stays mapped until the last snapshot that reads it is gone
+    ownedOriginal.reset();
+    // Nothing is read here: the pages of the file are loaded by the operating system when they are touched
+    mappedOriginal = mapping;
+    original = mappedOriginal->data();
+    originalSize = mappedOriginal->size();
+
+    // The newline after the last line is a terminator, not the start of an extra empty line
+    if (originalSize > 0 && original[originalSize - 1] == '\n') {
+        originalSize--;
+    }
+    resetPieces(background);
+    return true;
+}
+
+// Function to start a new document made of the whole original buffer
+void PieceTable::resetPieces(bool background) {
+    nodes.releaseAll();  // Drop every piece of the previous document at once, whatever their number
+    root = nullptr;
+    typingPath.clear();
+    addBlocks.clear();  // Nothing has been typed yet (the snapshots keep the blocks they read)
+    addedSize = 0;
+    addedCapacity = 0;
+    sharedAdded = 0;
+    addedBreaks.clear();
+    loadedSize = 0;
+    loadedLineFeeds = 0;
+    originalBreaks.build(original, originalSize, background);  // Only counts the line feeds of every chunk
+
+    // Without a worker the whole file is indexed already and becomes a single piece
+    if (!background) {
+        pollLoad();
+    }
+}
+
+// Function to append the part of the original buffer indexed since the last call
+void PieceTable::pollLoad() {
+    size_t indexedLineFeeds;
+    size_t indexed = originalBreaks.countedBytes(&indexedLineFeeds);
+    if (indexed <= loadedSize) {
+        return;
+    }
+    // The new part always goes at the end of the document, whatever was edited before it
+    typingPath.clear();
+    size_t count = indexed - loadedSize;
+    size_t lineFeeds = indexedLineFeeds - loadedLineFeeds;
+    if (!extendLastPiece(root, Piece::ORIGINAL, loadedSize, count, lineFeeds)) {
+        Piece piece = {Piece::ORIGINAL, loadedSize, count, lineFeeds};
+        root = merge(root, createNode(piece));
+    }
+    loadedSize = indexed;
+    loadedLineFeeds = indexedLineFeeds;
+}
+
+// Function to know whether part of the opened file is not in the document yet
+bool PieceTable::isLoading() const {
+    return loadedSize < originalSize;
+}
+
+// Function to get the fraction of the opened file that is in the document
+float PieceTable::loadProgress() const {
+    return originalSize == 0 ? 1.f : static_cast<float>(loadedSize) / originalSize;
+}
+
+// Function to stop a background open
+void PieceTable::cancelLoad() {
+    originalBreaks.cancel();
+    mappedOriginal.reset();
+    ownedOriginal.reset();
+    original = nullptr;
+    originalSize = 0;
+    resetPieces(false);  // Start again from an empty document
+}
+
+// Function to insert text at a document offset
+void PieceTable::insert(size_t offset, const char* text, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (offset > length()) {
+        offset = length();  // Clamp the offset to the end of the document
+    }
+
+    // Append the characters to the add buffer; existing characters never move
+    size_t addStart = appendAdded(text, count);
+    size_t breaksBefore = addedBreaks.size();
+    TextScan::findAll(text, count, '\n', addStart, addedBreaks);  // Record the position of every '\n' in the add buffer
+    size_t lineFeeds = addedBreaks.size() - breaksBefore;
+
+    // Typing at the end of the previous insertion only grows its piece along the saved path:
+    // no split, no merge and no new node, whatever the size of the line or of the document
+    if (!typingPath.empty() && offset == typingEnd) {
+        PieceNode* node = typingPath.back();
+        if (node->piece.start + node->piece.length == addStart) {
+            node->piece.length += count;
+            node->piece.lineFeeds += lineFeeds;
+            for (PieceNode* ancestor : typingPath) {
+                ancestor->subtreeLength += count;
+                ancestor->subtreeLineFeeds += lineFeeds;
+            }
+            typingEnd += count;
+            return;
+        }
+    }
+
+    PieceNode* left;
+    PieceNode* right;
+    split(root, offset, left, right);
+
+    // When typing continues right after the previous insertion, grow that piece instead of adding a new one
+    if (!extendLastPiece(left, Piece::ADDED, addStart, count, lineFeeds)) {
+        Piece piece = {Piece::ADDED, addStart, count, lineFeeds};
+        left = merge(left, createNode(piece));
+    }
+    root = merge(left, right);
+    findTypingPath(offset + count);  // The next keystroke at the new cursor takes the fast path
+}
+
+// Function to remove a range of the document
+void PieceTable::erase(size_t offset, size_t count) {
+    if (offset >= length() || count == 0) {
+        return;
+    }
+    if (count > length() - offset) {
+        count = length() - offset;  // Clamp the range to the end of the document
+    }
+
+    // Backspacing over text that was just typed gives it back to the end of the add buffer (the text of a
+    // range of the add buffer belongs to one piece only), so typing and erasing at the cursor work like a gap buffer
+    // Text that a snapshot may still read is not given back, the next keystrokes would overwrite it.
+    if (!typingPath.empty() && offset + count == typingEnd) {
+        PieceNode* node = typingPath.back();
+        if (count < node->piece.length && node->piece.start + node->piece.length == addedSize && addedSize - count >= sharedAdded) {
+            size_t newEnd = addedSize - count;
+            size_t lineFeeds = addedBreaks.end() - lower_bound(addedBreaks.begin(), addedBreaks.end(), newEnd);
+            addedBreaks.resize(addedBreaks.size() - lineFeeds);
+            addedSize = newEnd;
+            node->piece.length -= count;
+            node->piece.lineFeeds -= lineFeeds;
+            for (PieceNode* ancestor : typingPath) {
+                ancestor->subtreeLength -= count;
+                ancestor->subtreeLineFeeds -= lineFeeds;
+            }
+            typingEnd = offset;
+            return;
+        }
+    }
+    typingPath.clear();  // The tree changes shape below
+
+    // Cut the range out of the tree and free the pieces that covered it
+    PieceNode* left;
+    PieceNode* middle;
+    PieceNode* right;
+    split(root, offset, left, middle);
+    split(middle, count, middle, right);
+    destroy(middle);
+    root = merge(left, right);
+}
+
+// Function to save the path from the root to the piece that ends at a document offset
+// The path is kept only when that piece is the last text of the add buffer, so the next insertion
+// at the offset can grow it. Any other change of the tree clears it.
+void PieceTable::findTypingPath(size_t end) {
+    typingPath.clear();
+    if (end == 0) {
+        return;
+    }
+    PieceNode* node = root;
+    size_t target = end - 1;  // Last character of the piece
+    while (node) {
+        typingPath.push_back(node);
+        size_t leftLength = lengthOf(node->left);
+        if (target < leftLength) {
+            node = node->left;
+        } else if (target < leftLength + node->piece.length) {
+            // Found the piece: keep the path only if it ends at the offset and at the end of the add buffer
+            if (node->piece.buffer == Piece::ADDED && target - leftLength == node->piece.length - 1
+                && node->piece.start + node->piece.length == addedSize) {
+                typingEnd = end;
+                return;
+            }
+            break;
+        } else {
+            target -= leftLength + node->piece.length;
+            node = node->right;
+        }
+    }
+    typingPath.clear();
+}
+
+// Function to get the number of characters in the document
+size_t PieceTable::length() const {
+    return lengthOf(root);
+}
+
+// Function to get the number of lines in the document
+size_t PieceTable::lineCount() const {
+    return lineFeedsOf(root) + 1;  // n line feeds separate n + 1 lines
+}
+
+// Function to find the offset of the first character of a line
+size_t PieceTable::lineStart(size_t line) const {
+    if (line == 0) {
+        return 0;
+    }
+    if (line >= lineCount()) {
+        return length();
+    }
+
+    // The line starts right after the line-th '\n' of the document
+    size_t remaining = line;
+    size_t offset = 0;
+    const PieceNode* node = root;
+    while (node) {
+        size_t leftLineFeeds = lineFeedsOf(node->left);
+        if (remaining <= leftLineFeeds) {
+            node = node->left;  // The line feed is in the left subtree
+            continue;
+        }
+        remaining -= leftLineFeeds;
+        offset += lengthOf(node->left);
+        if (remaining <= node->piece.lineFeeds) {
+            // The line feed is inside this piece: look it up in the newline index of its buffer
+            size_t first = lineFeedsBefore(node->piece, node->piece.start);
+            return offset + (lineFeedPosition(node->piece, first + remaining - 1) - node->piece.start) + 1;
+        }
+        remaining -= node->piece.lineFeeds;
+        offset += node->piece.length;
+        node = node->right;  // The line feed is in the right subtree
+    }
+    return length();
+}
+
+// Function to get the number of characters in a line
+size_t PieceTable::lineLength(size_t line) const {
+    size_t start = lineStart(line);
+    if (line + 1 >= lineCount()) {
+        return length() - start;  // The last line has no '\n'
+    }
+    return lineStart(line + 1) - 1 - start;
+}
+
+// Function to find the line that contains an offset
+size_t PieceTable::lineOfOffset(size_t offset) const {
+    size_t line = 0;
+    const PieceNode* node = root;
+    while (node) {
+        size_t leftLength = lengthOf(node->left);
+        if (offset < leftLength) {
+            node = node->left;
+            continue;
+        }
+        offset -= leftLength;
+        line += lineFeedsOf(node->left);
+        if (offset < node->piece.length) {
+            return line + countLineFeeds(node->piece, offset);  // Count the line feeds before the offset in this piece
+        }
+        offset -= node->piece.length;
+        line += node->piece.lineFeeds;
+        node = node->right;
+    }
+    return line;
+}
+
+// Function to read one character of the document
+char PieceTable::charAt(size_t offset) const {
+    const PieceNode* node = root;
+    while (node) {
+        size_t leftLength = lengthOf(node->left);
+        if (offset < leftLength) {
+            node = node->left;
+            continue;
+        }
+        offset -= leftLength;
+        if (offset < node->piece.length) {
+            return characters(node->piece)[offset];
+        }
+        offset -= node->piece.length;
+        node = node->right;
+    }
+    return '\0';  // The offset is past the end of the document
+}
+
+// Function to copy a range of the document into a string
+string PieceTable::getText(size_t offset, size_t count) const {
+    string text;
+    text.reserve(count);
+    forEachSpan(offset, count, [&text](const char* data, size_t size) {
+        text.append(data, size);
+    });
+    return text;
+}
+
+// Function to copy one line of the document into a string
+string PieceTable::getLine(size_t line) const {
+    return getText(lineStart(line), lineLength(line));
+}
+
+// Function to replace many ranges of the document in one pass
+void PieceTable::replaceRanges(const vector<Replacement>& ranges, const string& texts) {
+    if (ranges.empty()) {
+        return;
+    }
+    // Every new text is appended to the add buffer at once
+    typingPath.clear();
+    size_t addStart = appendAdded(texts.data(), texts.size());
+    TextScan::findAll(texts.data(), texts.size(), '\n', addStart, addedBreaks);
+
+    // Cut out the region from the first to the last range; the pieces around it are not touched
+    size_t regionStart = ranges.front().position;
+    size_t regionEnd = ranges.back().position + ranges.back().oldLength;
+    PieceNode* left;
+    PieceNode* middle;
+    PieceNode* right;
+    split(root, regionStart, left, middle);
+    split(middle, regionEnd - regionStart, middle, right);
+    vector<Piece> oldPieces;
+    collectPieces(middle, oldPieces);
+    destroy(middle);
+
+    // New pieces of the region; a span that continues the previous one in the same buffer is joined to it
+    PieceNode* rebuilt = nullptr;
+    Piece pending = {Piece::ADDED, 0, 0, 0};
+    auto emit = [&](Piece::Buffer buffer, size_t start, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        if (pending.length > 0 && pending.buffer == buffer && pending.start + pending.length == start) {
+            pending.length += count;
+            return;
+        }
+        if (pending.length > 0) {
+            pending.lineFeeds = countLineFeeds(pending, pending.length);
+            rebuilt = merge(rebuilt, createNode(pending));
+        }
+        pending = {buffer, start, count, 0};
+    };
+
+    // One walk over the old pieces: copy the text between the ranges, skip the ranges, add their new text
+    size_t piece = 0;          // Old piece the walk is in
+    size_t inPiece = 0;        // Characters of that piece already walked
+    size_t position = regionStart;
+    auto walkTo = [&](size_t target, bool keep) {
+        while (position < target) {
+            const Piece& current = oldPieces[piece];
+            size_t take = min(current.length - inPiece, target - position);
+            if (keep) {
+                emit(current.buffer, current.start + inPiece, take);
+            }
+            inPiece += take;
+            position += take;
+            if (inPiece == current.length) {
+                piece++;
+                inPiece = 0;
+            }
+        }
+    };
+    size_t textOffset = addStart;
+    for (const Replacement& range : ranges) {
+        walkTo(range.position, true);
+        emit(Piece::ADDED, textOffset, range.newLength);
+        textOffset += range.newLength;
+        walkTo(range.position + range.oldLength, false);
+    }
+    // Add the last piece
+    if (pending.length > 0) {
+        pending.lineFeeds = countLineFeeds(pending, pending.length);
+        rebuilt = merge(rebuilt, createNode(pending));
+    }
+    root = merge(merge(left, rebuilt), right);
+}
+
+// Function to get the number of pieces of the document
+size_t PieceTable::pieceCount() const {
+    return nodes.size();
+}
+
+// Function to take a snapshot of the document for another thread
+// The spans point straight into the buffers, which the snapshot shares: it costs one walk over the pieces
+// and one reference per block, whatever the size of the text.
+void PieceTable::snapshot(TextSnapshot& out) const {
+    out.spans.clear();
+    out.spans.reserve(nodes.size());
+    collectSpans(root, out.spans);
+    if (mappedOriginal) {
+        out.original = mappedOriginal;
+    } else {
+        out.original = ownedOriginal;
+    }
+    out.addBlocks = addBlocks;
+    out.length = length();
+    sharedAdded = addedSize;  // From now on the text of the snapshot is never given back to be typed over
+}
+
+// Function to list the pieces of a subtree in document order
+void PieceTable::collectPieces(const PieceNode* node, vector<Piece>& pieces) {
+    if (node) {
+        collectPieces(node->left, pieces);
+        pieces.push_back(node->piece);
+        collectPieces(node->right, pieces);
+    }
+}
+
+// Function to list the characters of the pieces of a subtree in document order
+void PieceTable::collectSpans(const PieceNode* node, vector<pair<const char*, size_t>>& spans) const {
+    while (node) {
+        collectSpans(node->left, spans);
+        spans.emplace_back(characters(node->piece), node->piece.length);
+        node = node->right;  // The right subtree is walked in the loop, so only left children take stack
+    }
+}
+
+// Function to get the number of bytes used by the document structures
+size_t PieceTable::memoryUsage() const {
+    size_t blocks = count_if(addBlocks.begin(), addBlocks.end(), [](const shared_ptr<char>& block) { return block != nullptr; });
+    return nodes.memoryUsage() + blocks * ADD_BLOCK + addedBreaks.capacity() * sizeof(size_t)
+         + (ownedOriginal ? ownedOriginal->capacity() : 0) + originalBreaks.memoryUsage();
+}
+
+// Function to append characters to the add buffer
+// They go at the end of the last block while they fit. Otherwise they start a new block, big enough for
+// all of them, so the characters of a piece are always contiguous in memory. A new block always starts
+// after a gap, so text of two blocks never looks contiguous and is never joined into one piece.
+size_t PieceTable::appendAdded(const char* text, size_t count) {
+    if (addedSize + count > addedCapacity) {
+        size_t start = addBlocks.empty() ? 0 : (addedSize / ADD_BLOCK + 1) * ADD_BLOCK;
+        size_t entries = count == 0 ? 1 : (count + ADD_BLOCK - 1) / ADD_BLOCK;
+        shared_ptr<char> block(new char[entries * ADD_BLOCK], default_delete<char[]>());
+        addBlocks.resize(start / ADD_BLOCK);  // The gap has no block
+        for (size_t i = 0; i < entries; i++) {
+            addBlocks.emplace_back(block, block.get() + i * ADD_BLOCK);  // Every entry shares the block
+        }
+        addedSize = start;
+        addedCapacity = start + entries * ADD_BLOCK;
+    }
+    size_t start = addedSize;
+    if (count > 0) {
+        memcpy(addBlocks[start / ADD_BLOCK].get() + start % ADD_BLOCK, text, count);
+    }
+    addedSize += count;
+    return start;
+}
+
+// Function to get the first character of a piece
+const char* PieceTable::characters(const Piece& piece) const {
+    if (piece.buffer == Piece::ORIGINAL) {
+        return original + piece.start;
+    }
+    return addBlocks[piece.start / ADD_BLOCK].get() + piece.start % ADD_BLOCK;
+}
+
+// Function to count the line feeds before a position of the buffer a piece points into
+size_t PieceTable::lineFeedsBefore(const Piece& piece, size_t position) const {
+    if (piece.buffer == Piece::ORIGINAL) {
+        return originalBreaks.countBefore(position);
+    }
+    return lower_bound(addedBreaks.begin(), addedBreaks.end(), position) - addedBreaks.begin();
+}
+
+// Function to get the position of a line feed of the buffer a piece points into from its index
+size_t PieceTable::lineFeedPosition(const Piece& piece, size_t index) const {
+    if (piece.buffer == Piece::ORIGINAL) {
+        return originalBreaks.position(index);
+    }
+    return addedBreaks[index];
+}
+
+// Function to count the line feeds in the first count characters of a piece
+size_t PieceTable::countLineFeeds(const Piece& piece, size_t count) const {
+    // Two lookups in the newline index, no character is scanned
+    return lineFeedsBefore(piece, piece.start + count) - lineFeedsBefore(piece, piece.start);
+}
+
+// Function to allocate a new tree node for a piece
+PieceNode* PieceTable::createNode(const Piece& piece) {
+    PieceNode* node = nodes.allocate();  // Taken from a slab, no allocation most of the time
+    *node = PieceNode{piece, nullptr, nullptr, 0, 0};
+    update(node);
+    return node;
+}
+
+// Function to free a subtree
+void PieceTable::destroy(PieceNode* node) {
+    if (!node) {
+        return;
+    }
+    destroy(node->left);
+    destroy(node->right);
+    nodes.release(node);  // The slot is reused by the next node
+}
+
+// Function to split a subtree into the first offset characters and the rest
+// A piece that straddles the offset is cut into two pieces.
+void PieceTable::split(PieceNode* node, size_t offset, PieceNode*& left, PieceNode*& right) {
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    size_t leftLength = lengthOf(node->left);
+    if (offset <= leftLength) {
+        // The cut is inside the left subtree, so this node goes to the right part
+        split(node->left, offset, left, node->left);
+        right = node;
+    } else if (offset >= leftLength + node->piece.length) {
+        // The cut is inside the right subtree, so this node goes to the left part
+        split(node->right, offset - leftLength - node->piece.length, node->right, right);
+        left = node;
+    } else {
+        // The cut is inside this piece: keep the head here and move the tail into a new node
+        size_t cut = offset - leftLength;
+        Piece tail = node->piece;
+        tail.start += cut;
+        tail.length -= cut;
+        node->piece.length = cut;
+        node->piece.lineFeeds = countLineFeeds(node->piece, cut);
+        tail.lineFeeds -= node->piece.lineFeeds;
+
+        PieceNode* rest = node->right;
+        node->right = nullptr;
+        left = node;
+        right = merge(createNode(tail), rest);
+    }
+    update(node);
+}
+
+// Function to join two subtrees where every piece of left comes before every piece of right
+PieceNode* PieceTable::merge(PieceNode* left, PieceNode* right) {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    // The node with the higher priority becomes the root
+    if (priorityOf(left) > priorityOf(right)) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+// Function to get the heap priority of a node
+// The address is mixed with the 64 bit finalizer of MurmurHash3, which makes the priorities of the
+// nodes of a slab look random; a priority field would make every node 8 bytes bigger.
+unsigned PieceTable::priorityOf(const PieceNode* node) {
+    uint64_t hash = reinterpret_cast<uintptr_t>(node);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return static_cast<unsigned>(hash);
+}
+
+// Function to grow the last piece of a subtree when it ends exactly where the new text starts in the same buffer
+bool PieceTable::extendLastPiece(PieceNode* node, Piece::Buffer buffer, size_t bufferEnd, size_t count, size_t lineFeeds) {
+    if (!node) {
+        return false;
+    }
+    // The last piece is at the end of the right spine
+    PieceNode* last = node;
+    while (last->right) {
+        last = last->right;
+    }
+    if (last->piece.buffer != buffer || last->piece.start + last->piece.length != bufferEnd) {
+        return false;
+    }
+    // Every node of the right spine contains the last piece, so all their totals grow
+    for (PieceNode* spine = node; spine; spine = spine->right) {
+        spine->subtreeLength += count;
+        spine->subtreeLineFeeds += lineFeeds;
+    }
+    last->piece.length += count;
+    last->piece.lineFeeds += lineFeeds;
+    return true;
+}
+
+// Function to recompute the cached totals of a node from its children
+void PieceTable::update(PieceNode* node) {
+    node->subtreeLength = lengthOf(node->left) + node->piece.length + lengthOf(node->right);
+    node->subtreeLineFeeds = lineFeedsOf(node->left) + node->piece.lineFeeds + lineFeedsOf(node->right);
+}
+
+// Function to get the total length of a possibly empty subtree
+size_t PieceTable::lengthOf(const PieceNode* node) {
+    return node ? node->subtreeLength : 0;
+}
+
+// Function to get the total line feeds of a possibly empty subtree
+size_t PieceTable::lineFeedsOf(const PieceNode* node) {
+    return node ? node->subtreeLineFeeds : 0;
+}
@@ -0,0 +1,204 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <string>   // For the original and add buffers
+#include <vector>   // For the newline position indexes
+#include <cstddef>  // For size_t
+#include <utility>  // For the spans of a snapshot
+#include <memory>   // For the buffers shared with the snapshots
+#include "mappedFile.h" // For the memory mapped original buffer
+#include "lineIndex.h"  // For the lazily built line index of the original buffer
+#include "nodePool.h"   // For the slab allocator of the tree nodes
+
+// Piece struct to describe one span of text
+// A piece does not own any characters, it only points into one of the two buffers of the
+// piece table (the immutable original buffer or the append-only add buffer).
+// The buffer is a single bit stored with the start offset, which keeps a piece at 24 bytes.
+struct Piece {
+    enum Buffer : size_t { ORIGINAL, ADDED };
+    Buffer buffer : 1; // Which buffer the span points into
+    size_t start : 63; // Offset of the first character inside the buffer
+    size_t length;     // Number of characters covered by the span
+    size_t lineFeeds;  // Number of '\n' characters inside the span
+};
+
+// PieceNode struct to store a piece inside the balanced tree
+// The tree is a treap ordered by document position; every node caches the total length and
+// the total number of line feeds of its subtree so offsets and line numbers can be found in O(log n).
+// The heap priority of a node is a hash of its address (see priorityOf), so a node is 56 bytes.
+struct PieceNode {
+    Piece piece;              // The span stored in this node
+    PieceNode* left;          // Pieces that come before this one in the document
+    PieceNode* right;         // Pieces that come after this one in the document
+    size_t subtreeLength;     // Sum of the piece lengths in this subtree
+    size_t subtreeLineFeeds;  // Sum of the line feeds in this subtree
+};
+
+// Replacement struct to describe one range changed by a batch replacement
+struct Replacement {
+    size_t position;   // Offset of the range in the document before the batch
+    size_t oldLength;  // Number of characters removed
+    size_t newLength;  // Number of characters that replace them
+};
+
+// TextSnapshot struct to read one version of the document from another thread
+// The spans point into characters that are never written again: the original buffer and the blocks of the
+// add buffer, which only grows and never moves. The snapshot holds a reference to every one of them, so it
+// stays readable after the document is edited, or another file is opened, and any number of threads can
+// read it without a lock. Taking one copies no text, only the list of spans.
+struct TextSnapshot {
+    std::vector<std::pair<const char*, size_t>> spans; // Characters of the document, in order
+    std::shared_ptr<const void> original;               // Keeps the original buffer alive (mapped file or string)
+    std::vector<std::shared_ptr<char>> addBlocks;       // Keeps the blocks of the add buffer alive
+    size_t length = 0;                                  // Number of characters of the document
+};
+
+// PieceTable class to hold the whole document
+// The text of the loaded file is kept untouched in the original buffer and every typed character is
+// appended to the add buffer. The document is the in-order sequence of pieces in the tree, so insert,
+// delete, newline split and line merge only split or join pieces and never move existing characters.
+class PieceTable {
+public:
+    // Constructor to create an empty document
+    PieceTable();
+    // Destructor to free every node of the tree
+    ~PieceTable();
+
+    // The table owns raw tree nodes, so it cannot be copied
+    PieceTable(const PieceTable&) = delete;
+    PieceTable& operator=(const PieceTable&) = delete;
+
+    // Method to replace the whole document with the given text (it becomes the original buffer)
+    void load(std::string text);
+    // Method to replace the whole document with a file mapped read-only as the original buffer
+    // The '\n' that ends the last line of the file is not part of the document.
+    // When background is true the file is indexed by a worker thread: the document starts empty and
+    // pollLoad() appends the part indexed so far, so the first lines can be shown before the end is known.
+    bool open(const std::string& filename, bool background = false);
+    // Method to append the part of the file indexed since the last call (call it once per frame while loading)
+    void pollLoad();
+    // Method to know whether part of the opened file is not in the document yet
+    bool isLoading() const;
+    // Method to get the fraction of the opened file that is in the document (0 to 1)
+    float loadProgress() const;
+    // Method to stop a background open; the document becomes empty
+    void cancelLoad();
+    // Method to insert count characters at the given document offset
+    void insert(size_t offset, const char* text, size_t count);
+    // Method to remove count characters starting at the given document offset
+    void erase(size_t offset, size_t count);
+    // Method to replace many ranges in one pass (used by replace-all)
+    // The ranges are sorted and do not overlap; range i is replaced by the next newLength characters of texts.
+    // Only the pieces between the first and the last range are rebuilt, and the new text is appended once.
+    void replaceRanges(const std::vector<Replacement>& ranges, const std::string& texts);
+
+    // Method to get the number of characters in the document
+    size_t length() const;
+    // Method to get the number of lines in the document (always at least 1)
+    size_t lineCount() const;
+    // Method to get the offset of the first character of a line
+    size_t lineStart(size_t line) const;
+    // Method to get the number of characters in a line (without its '\n')
+    size_t lineLength(size_t line) const;
+    // Method to get the line that contains the given offset
+    size_t lineOfOffset(size_t offset) const;
+    // Method to read the character at the given offset
+    char charAt(size_t offset) const;
+    // Method to copy a range of the document into a string
+    std::string getText(size_t offset, size_t count) const;
+    // Method to copy one line of the document (without its '\n') into a string
+    std::string getLine(size_t line) const;
+    // Method to get the number of bytes used by the document structures (the mapped file is not counted)
+    size_t memoryUsage() const;
+    // Method to get the number of pieces of the document
+    size_t pieceCount() const;
+
+    // Method to take a snapshot of the document that stays readable for as long as it is kept
+    // No text is copied: the snapshot shares the buffers, and the typed text it reads is never given back.
+    void snapshot(TextSnapshot& out) const;
+
+    // Method to visit the document as contiguous spans, in order, without copying them
+    // The callback receives a pointer to the characters and the number of characters.
+    template <typename Visitor>
+    void forEachSpan(size_t offset, size_t count, Visitor visit) const {
+        visitSpans(root, offset, count, visit);
+    }
+
+private:
+    std::shared_ptr<std::string> ownedOriginal; // Original text when it was given as a string (shared with the snapshots)
+    std::shared_ptr<MappedFile> mappedOriginal; // Original text when it was mapped from a file (shared with the snapshots)
+    const char* original;                // Start of the immutable original buffer (inside one of the two above)
+    size_t originalSize;                 // Number of characters of the original buffer
+    size_t loadedSize;                   // Characters of the original buffer that have been added to the document
+    size_t loadedLineFeeds;              // Line feeds inside those characters
+    LineIndex originalBreaks;            // Lazily built index of the '\n' inside the original buffer
+    std::vector<std::shared_ptr<char>> addBlocks; // Append-only text of every insertion, one entry per block of
+                                         // the add buffer (a large insertion gets a block of several entries)
+    size_t addedSize;                    // Number of characters of the add buffer, gaps between blocks included
+    size_t addedCapacity;                // End of the last block: characters up to it are appended in place
+    mutable size_t sharedAdded;          // End of the add buffer when the last snapshot was taken
+    std::vector<size_t> addedBreaks;     // Positions of every '\n' inside the add buffer
+    PieceNode* root;                     // Root of the treap of pieces
+    NodePool<PieceNode> nodes;           // Slabs every node of the treap is allocated from
+    std::vector<PieceNode*> typingPath;  // Root to the piece that ends at typingEnd, empty when unknown
+    size_t typingEnd;                    // Document offset where the last insertion ended
+
+    // Helper to start a new document on top of the current original buffer
+    void resetPieces(bool background);
+    // Helper to save the path to the piece that ends at an offset, for the typing fast path
+    void findTypingPath(size_t end);
+    // Helper to append characters to the add buffer, returns the add buffer offset of the first one
+    size_t appendAdded(const char* text, size_t count);
+    // Helpers to access the characters of a piece and the newline index of its buffer
+    const char* characters(const Piece& piece) const;
+    size_t lineFeedsBefore(const Piece& piece, size_t position) const;
+    size_t lineFeedPosition(const Piece& piece, size_t index) const;
+    // Helper to count the line feeds in the first count characters of a piece
+    size_t countLineFeeds(const Piece& piece, size_t count) const;
+
+    // Treap helpers
+    PieceNode* createNode(const Piece& piece);
+    void destroy(PieceNode* node);
+    void split(PieceNode* node, size_t offset, PieceNode*& left, PieceNode*& right);
+    PieceNode* merge(PieceNode* left, PieceNode* right);
+    bool extendLastPiece(PieceNode* node, Piece::Buffer buffer, size_t bufferEnd, size_t count, size_t lineFeeds);
+    static void update(PieceNode* node);
+    static unsigned priorityOf(const PieceNode* node);
+    static size_t lengthOf(const PieceNode* node);
+    static size_t lineFeedsOf(const PieceNode* node);
+
+    // Recursive in-order walk to list the pieces of the document
+    static void collectPieces(const PieceNode* node, std::vector<Piece>& pieces);
+    // Recursive in-order walk to list the characters of every piece, for a snapshot
+    void collectSpans(const PieceNode* node, std::vector<std::pair<const char*, size_t>>& spans) const;
+
+    // Recursive in-order walk used by forEachSpan
+    template <typename Visitor>
+    void visitSpans(const PieceNode* node, size_t offset, size_t count, Visitor& visit) const {
+        if (!node || count == 0) {
+            return;
+        }
+        size_t leftLength = lengthOf(node->left);
+        // Visit the left subtree only when the range starts inside it
+        if (offset < leftLength) {
+            size_t take = count < leftLength - offset ? count : leftLength - offset;
+            visitSpans(node->left, offset, take, visit);
+            count -= take;
+            offset = leftLength;
+        }
+        // Visit the piece of this node
+        size_t pieceOffset = offset - leftLength;
+        if (count > 0 && pieceOffset < node->piece.length) {
+            size_t take = count < node->piece.length - pieceOffset ? count : node->piece.length - pieceOffset;
+            visit(characters(node->piece) + pieceOffset, take);
+            count -= take;
+            offset = leftLength + node->piece.length;
+        }
+        // Continue in the right subtree with whatever is left of the range
+        if (count > 0) {
+            visitSpans(node->right, offset - leftLength - node->piece.length, count, visit);
+        }
+    }
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,374 @@
+#include    "recoveryJournal.h" // Include the header file for the crash recovery journal
+#include    <algorithm>   // For max and min
+#include    <chrono>      // For the flush interval
+#include    <cstdint>     // For the fixed size numbers of a record
+#include    <cstdlib>     // For strtoull
+#include    <cstring>     // For memcpy
+#include    <filesystem>  // For the size of the base file, rename and remove
+#include    <fstream>     // For reading a journal back
+#ifdef _WIN32
+#include    <io.h>        // For _commit
+#else
+#include    <fcntl.h>     // For opening the directory
+#include    <unistd.h>    // For fsync
+#endif
+using namespace std; // Use the standard namespace for convenience
+
+// First line of every journal, to recognize one (the number is the version of the format)
+const string JOURNAL_MAGIC = "NOTEPAD-JOURNAL 1";
+// Longest time a record waits in memory before it is written and flushed to disk
+const int SYNC_MS = 1000;
+// Amount of logged records that wakes the flush thread before the interval is over
+const size_t FLUSH_BYTES = 1 << 20;
+// Size of the chunks the kept records are copied in when the journal is rebased
+const size_t COPY_CHUNK = 1 << 20;
+// Size of a record before its payload: kind, two numbers and the payload size
+const size_t RECORD_HEADER = 1 + 3 * sizeof(uint64_t);
+
+// Function to get the header of a journal: the magic line, the size of the base file and its name
+static string headerText(const string& baseFile, unsigned long long baseSize) {
+    return JOURNAL_MAGIC + "\n" + to_string(baseSize) + "\n" + baseFile + "\n";
+}
+
+// Starting value of the checksum of a record
+const uint64_t CHECKSUM_SEED = 14695981039346656037ull;
+
+// Function to add bytes to the checksum of a record (FNV-1a, eight bytes at a time so large pastes stay cheap)
+static uint64_t addToChecksum(uint64_t hash, const char* data, size_t size) {
+    const uint64_t prime = 1099511628211ull;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    return hash;
+}
+
+// Function to append a number to a record
+static void appendNumber(vector<char>& records, uint64_t number) {
+    const char* bytes = reinterpret_cast<const char*>(&number);
+    records.insert(records.end(), bytes, bytes + sizeof(number));
+}
+
+// Function to read a number of a record
+static uint64_t readNumber(const char* bytes) {
+    uint64_t number;
+    memcpy(&number, bytes, sizeof(number));
+    return number;
+}
+
+// Function to flush a file to disk, so its records survive a crash of the process or of the system
+static void syncFile(FILE* file) {
+    fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+// Function to flush the directory of a file to disk, which makes a rename durable
+static void syncDirectory(const string& filename) {
+#ifndef _WIN32
+    size_t slash = filename.find_last_of('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+    int directoryFile = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (directoryFile >= 0) {
+        fsync(directoryFile);
+        ::close(directoryFile);
+    }
+#else
+    (void)filename;  // MoveFileEx makes the rename durable on its own
+#endif
+}
+
+// Constructor to create a journal that is not written anywhere
+RecoveryJournal::RecoveryJournal()
+    : file(nullptr), headerBytes(0), fileStart(0), writtenEnd(0), loggedEnd(0), rebasePending(false),
+      pendingRebase(), stopping(false) {}
+
+// Destructor to write the last records and stop the flush thread
+RecoveryJournal::~RecoveryJournal() {
+    stopFlusher();
+    if (file) {
+        fclose(file);
+    }
+}
+
+// Function to read the base file and the complete records of a journal
+bool RecoveryJournal::read(const string& journalFile, JournalContents& contents) {
+    ifstream input(journalFile, ios::binary);
+    string magic, sizeLine;
+    if (!input || !getline(input, magic) || magic != JOURNAL_MAGIC || !getline(input, sizeLine) ||
+        !getline(input, contents.baseFile)) {
+        return false;
+    }
+    contents.baseSize = strtoull(sizeLine.c_str(), nullptr, 10);
+    contents.edits.clear();
+    contents.validBytes = static_cast<size_t>(input.tellg());
+    input.seekg(0, ios::end);
+    size_t fileSize = static_cast<size_t>(input.tellg());
+    input.seekg(contents.validBytes);
+
+    // Records are read until the end, or until one is cut short or damaged by a crash
+    char header[RECORD_HEADER];
+    while (input.read(header, RECORD_HEADER)) {
+        char kind = header[0];
+        uint64_t first = readNumber(header + 1);
+        uint64_t second = readNumber(header + 1 + sizeof(uint64_t));
+        uint64_t payloadSize = readNumber(header + 1 + 2 * sizeof(uint64_t));
+        size_t recordEnd = contents.validBytes + RECORD_HEADER;
+        if (payloadSize > fileSize - recordEnd || fileSize - recordEnd - payloadSize < sizeof(uint64_t)) {
+            break;  // The record goes past the end of the file
+        }
+        // The checksum covers the whole record, read in one piece as it was written
+        string record(RECORD_HEADER + payloadSize, '\0');
+        memcpy(&record[0], header, RECORD_HEADER);
+        char checksum[sizeof(uint64_t)];
+        if (!input.read(&record[RECORD_HEADER], payloadSize) || !input.read(checksum, sizeof(checksum))) {
+            break;
+        }
+        if (addToChecksum(CHECKSUM_SEED, record.data(), record.size()) != readNumber(checksum)) {
+            break;
+        }
+        string payload = record.substr(RECORD_HEADER);
+
+        JournalEdit edit = JournalEdit();
+        if (kind == 'I' && second == payloadSize) {
+            edit.op = Command::ADD;
+            edit.position = first;
+            edit.text.swap(payload);
+        } else if (kind == 'E' && payloadSize == 0) {
+            edit.op = Command::DELETE;
+            edit.position = first;
+            edit.length = second;
+        } else if (kind == 'R' && first <= payloadSize / sizeof(Replacement) && second == payloadSize - first * sizeof(Replacement)) {
+            edit.op = Command::REPLACE;
+            edit.ranges.resize(first);
+            memcpy(edit.ranges.data(), payload.data(), first * sizeof(Replacement));
+            edit.text = payload.substr(first * sizeof(Replacement));
+        } else {
+            break;  // Not a record this version writes
+        }
+        contents.edits.push_back(move(edit));
+        contents.validBytes = recordEnd + payloadSize + sizeof(uint64_t);
+    }
+    return true;
+}
+
+// Function to start journaling, either from an empty document or after the records of an existing journal
+bool RecoveryJournal::open(const string& newJournalFile, const JournalContents* contents) {
+    stopFlusher();
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    journalFile = newJournalFile;
+    stopping = false;
+    if (contents) {
+        // A record cut short by the crash is dropped, the new records go right after the last complete one
+        error_code error;
+        filesystem::resize_file(journalFile, contents->validBytes, error);
+        file = fopen(journalFile.c_str(), "ab");
+        headerBytes = headerText(contents->baseFile, contents->baseSize).size();
+        fileStart = 0;
+        writtenEnd = contents->validBytes - headerBytes;
+        loggedEnd = writtenEnd;
+    } else {
+        // The flush thread writes the journal of the empty document
+        fileStart = 0;
+        writtenEnd = 0;
+        loggedEnd = 0;
+        rebasePending = true;
+        pendingRebase = Rebase{"", 0, 0};
+    }
+    bool opened = file != nullptr || !contents;  // From here on only the flush thread uses the file
+    flusher = thread(&RecoveryJournal::flushLoop, this);
+    return opened;
+}
+
+// Function to know whether the edits are journaled
+bool RecoveryJournal::isOpen() const {
+    return !journalFile.empty();
+}
+
+// Function to delete the journal when the editor closes normally (nothing has to be recovered then)
+void RecoveryJournal::close() {
+    if (!isOpen()) {
+        return;
+    }
+    stopFlusher();
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    error_code error;
+    filesystem::remove(journalFile, error);
+    filesystem::remove(journalFile + ".tmp", error);
+    journalFile.clear();
+}
+
+// Function to log an insertion with its text
+void RecoveryJournal::logInsert(size_t position, const char* text, size_t count) {
+    append('I', position, count, text, count);
+}
+
+// Function to log an erase; the removed text is not needed to replay it
+void RecoveryJournal::logErase(size_t position, size_t count) {
+    append('E', position, count, nullptr, 0);
+}
+
+// Function to log a batch replacement with its ranges and its new texts
+void RecoveryJournal::logReplace(const vector<Replacement>& ranges, const string& texts) {
+    append('R', ranges.size(), texts.size(), reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(Replacement),
+           texts.data(), texts.size());
+}
+
+// Function to get the position of the next record
+size_t RecoveryJournal::mark() const {
+    return loggedEnd;
+}
+
+// Function to ask the flush thread to rewrite the journal on a new base file
+void RecoveryJournal::rebase(const string& baseFile, size_t fromMark) {
+    if (!isOpen()) {
+        return;
+    }
+    // The size is taken now: the file is what the records from the mark on were made against
+    error_code error;
+    unsigned long long baseSize = baseFile.empty() ? 0 : filesystem::file_size(baseFile, error);
+    lock_guard<std::mutex> lock(mutex);
+    pendingRebase = Rebase{baseFile, error ? 0 : baseSize, fromMark};
+    rebasePending = true;
+    wake.notify_one();
+}
+
+// Function to append one record to the records waiting for the flush thread
+// A record is its kind, two numbers, the payload size, the payload and a checksum of all of it.
+void RecoveryJournal::append(char kind, size_t first, size_t second, const char* payload, size_t payloadSize,
+                             const char* extra, size_t extraSize) {
+    if (!isOpen()) {
+        return;
+    }
+    lock_guard<std::mutex> lock(mutex);
+    size_t start = pending.size();
+    pending.push_back(kind);
+    appendNumber(pending, first);
+    appendNumber(pending, second);
+    appendNumber(pending, payloadSize + extraSize);
+    pending.insert(pending.end(), payload, payload + payloadSize);
+    pending.insert(pending.end(), extra, extra + extraSize);
+    appendNumber(pending, addToChecksum(CHECKSUM_SEED, pending.data() + start, pending.size() - start));
+    loggedEnd += pending.size() - start;
+    if (pending.size() >= FLUSH_BYTES) {
+        wake.notify_one();
+    }
+}
+
+// Function run by the flush thread: every interval it takes the logged records and writes them in one go
+void RecoveryJournal::flushLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait_for(lock, chrono::milliseconds(SYNC_MS), [this] {
+            return stopping || rebasePending || pending.size() >= FLUSH_BYTES;
+        });
+        vector<char> records;
+        records.swap(pending);
+        bool rebasing = rebasePending;
+        Rebase rebase = pendingRebase;
+        rebasePending = false;
+        bool stop = stopping;
+
+        // The disk is written without the lock, so logging an edit never waits for it
+        lock.unlock();
+        if (rebasing) {
+            writeRebased(rebase, records);
+        } else if (!records.empty()) {
+            writeRecords(records);
+        }
+        lock.lock();
+        if (stop) {
+            return;
+        }
+    }
+}
+
+// Function to append records to the journal and flush them to disk
+void RecoveryJournal::writeRecords(const vector<char>& records) {
+    writtenEnd += records.size();
+    if (file && fwrite(records.data(), 1, records.size(), file) == records.size()) {
+        syncFile(file);
+    }
+}
+
+// Function to rewrite the journal with a new base file and the records from a mark on
+// The new journal is written next to the old one and renamed over it, so a crash during the rebase
+// leaves one of the two, never a mix.
+void RecoveryJournal::writeRebased(const Rebase& rebase, const vector<char>& records) {
+    string temporaryName = journalFile + ".tmp";
+    FILE* rebased = fopen(temporaryName.c_str(), "wb");
+    if (!rebased) {
+        writeRecords(records);  // Keep the old base; the records are still needed to recover
+        return;
+    }
+    string header = headerText(rebase.baseFile, rebase.baseSize);
+    bool failed = fwrite(header.data(), 1, header.size(), rebased) != header.size();
+
+    // Records of the old journal from the mark on (the edits made while a save was running)
+    size_t from = max(rebase.fromMark, fileStart);
+    if (file && from < writtenEnd) {
+        fflush(file);
+        ifstream old(journalFile, ios::binary);
+        old.seekg(static_cast<streamoff>(headerBytes + (from - fileStart)));
+        vector<char> chunk(min(COPY_CHUNK, writtenEnd - from));
+        for (size_t left = writtenEnd - from; left > 0 && !failed;) {
+            size_t take = min(left, chunk.size());
+            failed = !old.read(chunk.data(), take) || fwrite(chunk.data(), 1, take, rebased) != take;
+            left -= take;
+        }
+    }
+    // Records logged since the last write, from the mark on
+    size_t skip = min(rebase.fromMark > writtenEnd ? rebase.fromMark - writtenEnd : 0, records.size());
+    failed = failed || fwrite(records.data() + skip, 1, records.size() - skip, rebased) != records.size() - skip;
+    syncFile(rebased);
+    fclose(rebased);
+
+    error_code error;
+    if (!failed) {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+        filesystem::rename(temporaryName, journalFile, error);
+    }
+    if (failed || error) {
+        filesystem::remove(temporaryName, error);
+        if (!file) {
+            file = fopen(journalFile.c_str(), "ab");
+        }
+        writeRecords(records);
+        return;
+    }
+    syncDirectory(journalFile);
+    file = fopen(journalFile.c_str(), "ab");
+    headerBytes = header.size();
+    fileStart = max(rebase.fromMark, fileStart);
+    writtenEnd += records.size();
+}
+
+// Function to stop the flush thread once it wrote the records that are left
+void RecoveryJournal::stopFlusher() {
+    if (!flusher.joinable()) {
+        return;
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    flusher.join();
+}
@@ -0,0 +1,112 @@
+#ifndef RECOVERYJOURNAL_H
+#define RECOVERYJOURNAL_H
+
+#include <string>
+#include <vector>   // For the edits read back and the records waiting to be written
+#include <cstddef>  // For size_t
+#include <cstdio>   // For the journal file
+#include <mutex>    // For the records handed over to the flush thread
+#include <condition_variable> // For waking the flush thread
+#include <thread>   // For writing the journal in the background
+#include "undoJournal.h" // For the operations of the Command records
+#include "pieceTable.h"  // For the ranges of a batch replacement
+
+// JournalEdit struct to describe one edit read back from a recovery journal
+// It is a Command with what replaying it needs: an insert keeps its text, but an erase only keeps
+// its length, since the removed text is in the base file or in an earlier record.
+struct JournalEdit {
+    Command::Operation op;           // ADD, DELETE or REPLACE
+    size_t position;                 // Document offset where the edit starts (ADD and DELETE)
+    size_t length;                   // DELETE only: number of characters removed
+    std::string text;                // ADD: the inserted text; REPLACE: the new texts, one after the other
+    std::vector<Replacement> ranges; // REPLACE only: the replaced ranges, with offsets from before the replacement
+};
+
+// JournalContents struct to hold what a recovery journal left on disk describes
+struct JournalContents {
+    std::string baseFile;           // File the edits apply to (empty for a new document)
+    unsigned long long baseSize;    // Size of that file when the journal was started, to detect a changed file
+    std::vector<JournalEdit> edits; // Edits in the order they were made
+    size_t validBytes;              // Size of the journal up to the end of its last complete record
+};
+
+// RecoveryJournal class to keep an append-only log of the edits that are not saved yet
+// Every edit of the document is appended as a record with its position and its text, so after a crash
+// the document is rebuilt by opening the base file and replaying the records. Nothing of the document
+// itself is written: the cost of the journal is proportional to the edits, not to the file size.
+// The records are gathered in memory and a worker thread writes and flushes them to disk about once a
+// second, so typing never waits for the disk (a crash loses at most the last second of edits).
+// Opening a file or saving the document rebases the journal: it is rewritten with the new base file and
+// only the records made after that point, then renamed over the old one.
+class RecoveryJournal {
+public:
+    // Constructor to create a journal that is not written anywhere
+    RecoveryJournal();
+    // Destructor to write the last records and stop the flush thread (the file is kept)
+    ~RecoveryJournal();
+
+    // The flush thread works on this object, so it cannot be copied
+    RecoveryJournal(const RecoveryJournal&) = delete;
+    RecoveryJournal& operator=(const RecoveryJournal&) = delete;
+
+    // Method to read a journal left on disk, returns false when there is none or it is not a journal
+    // A record cut short by a crash ends the edits; the ones before it are returned.
+    static bool read(const std::string& journalFile, JournalContents& contents);
+
+    // Method to start journaling to a file, for a new empty document
+    // With contents (read from the same file), the journal goes on after its last complete record instead.
+    bool open(const std::string& journalFile, const JournalContents* contents = nullptr);
+    // Method to know whether the edits are journaled
+    bool isOpen() const;
+    // Method to write the last records and delete the journal, when the editor closes normally
+    void close();
+
+    // Methods to append an edit of the document; they only copy it, the flush thread writes it
+    void logInsert(size_t position, const char* text, size_t count);
+    void logErase(size_t position, size_t count);
+    void logReplace(const std::vector<Replacement>& ranges, const std::string& texts);
+
+    // Method to get the position of the next record, to rebase the journal at this point later
+    size_t mark() const;
+    // Method to make a file the new base of the journal, keeping only the records from a mark on
+    // It is called with the current mark when a file is opened, and with the mark taken when a save
+    // started once that save is on disk (edits made during the save stay in the journal).
+    void rebase(const std::string& baseFile, size_t fromMark);
+
+private:
+    // Rebase struct to describe a rebase waiting for the flush thread
+    struct Rebase {
+        std::string baseFile;         // New base file
+        unsigned long long baseSize;  // Its size when the rebase was asked for
+        size_t fromMark;              // First record kept
+    };
+
+    std::string journalFile;  // Path of the journal (empty while closed)
+    FILE* file;               // Journal opened for appending (used by the flush thread only)
+    size_t headerBytes;       // Size of the header of the journal on disk
+    size_t fileStart;         // Mark of the first record in the file on disk
+    size_t writtenEnd;        // Mark of the end of the records written to the file
+    size_t loggedEnd;         // Mark of the end of every record logged so far (editor thread)
+
+    std::mutex mutex;                 // Protects the members below
+    std::condition_variable wake;     // Wakes the flush thread early (large records, rebase, stop)
+    std::vector<char> pending;        // Records logged but not written yet
+    bool rebasePending;               // True when pendingRebase waits for the flush thread
+    Rebase pendingRebase;             // Last rebase asked for
+    bool stopping;                    // True when the flush thread must write what is left and end
+    std::thread flusher;              // Thread writing the records to disk
+
+    // Helper to append one record: its kind, two numbers, and a payload made of two parts
+    void append(char kind, size_t first, size_t second, const char* payload, size_t payloadSize,
+                const char* extra = nullptr, size_t extraSize = 0);
+    // Helper run by the flush thread
+    void flushLoop();
+    // Helper to write the records taken from pending to the end of the file and flush them to disk
+    void writeRecords(const std::vector<char>& records);
+    // Helper to rewrite the journal with a new base and the records from a mark on, then rename it over the old one
+    void writeRebased(const Rebase& rebase, const std::vector<char>& records);
+    // Helper to stop the flush thread after it wrote what is left
+    void stopFlusher();
+};
+
+#endif // RECOVERYJOURNAL_H
@@ -0,0 +1,237 @@
+#include    "regexSearch.h" // Include the header file for the background regex search
+#include    <algorithm>     // For lower_bound and min
+#include    <cstring>       // For memchr
+using namespace std; // Use the standard namespace for convenience
+
+// Matches are handed to the editor at least once per this many searched characters
+const size_t PUBLISH_BYTES = 1 << 20;
+// ... or as soon as this many matches are waiting
+const size_t PUBLISH_MATCHES = 1024;
+
+// Constructor to create a search without a pattern
+RegexSearch::RegexSearch() : valid(true), stopRequested(false), finished(true), searchedBytes(0), found(0), skipped(0) {}
+
+// Destructor to stop the search thread
+RegexSearch::~RegexSearch() {
+    stop();
+}
+
+// Function to start searching a snapshot of the document
+bool RegexSearch::start(const PieceTable& document, const string& newPattern) {
+    clear();  // Stops the previous search and drops its matches
+    if (newPattern.empty()) {
+        return true;
+    }
+    pattern = newPattern;
+    try {
+        expression.assign(pattern, regex::ECMAScript | regex::optimize);
+    } catch (const regex_error&) {
+        valid = false;  // Keep the pattern so it can still be shown and edited
+        return false;
+    }
+
+    // The worker only reads the snapshot, never the document, so the editor can keep editing it
+    document.snapshot(text);
+    finished.store(false);
+    worker = thread(&RegexSearch::searchSnapshot, this);
+    return true;
+}
+
+// Function to stop the search and forget the pattern and every match
+void RegexSearch::clear() {
+    stop();
+    pattern.clear();
+    valid = true;
+    matches.clear();
+    pending.clear();
+    text = TextSnapshot();  // Release the buffers the snapshot shares
+    searchedBytes.store(0);
+    found.store(0);
+    skipped.store(0);
+}
+
+// Function to move the matches found since the last call into the polled matches
+void RegexSearch::poll() {
+    lock_guard<mutex> lock(pendingMutex);
+    // The worker goes through the document in order, so the new matches all come after the old ones
+    matches.insert(matches.end(), pending.begin(), pending.end());
+    pending.clear();
+}
+
+// Function to get the current pattern
+const string& RegexSearch::getPattern() const {
+    return pattern;
+}
+
+// Function to know whether the pattern is a valid expression
+bool RegexSearch::isValid() const {
+    return valid;
+}
+
+// Function to know whether the worker is still searching
+bool RegexSearch::isSearching() const {
+    return worker.joinable() && !finished.load();
+}
+
+// Function to get the fraction of the snapshot searched so far
+float RegexSearch::progress() const {
+    return text.length == 0 ? 1.f : static_cast<float>(searchedBytes.load()) / text.length;
+}
+
+// Function to get the number of matches found so far
+size_t RegexSearch::foundCount() const {
+    return found.load();
+}
+
+// Function to get the number of lines skipped because they are too long
+size_t RegexSearch::skippedCount() const {
+    return skipped.load();
+}
+
+// Function to know whether every match the search kept is in the polled matches
+bool RegexSearch::isComplete() const {
+    return valid && !isSearching() && matches.size() == min(found.load(), MAX_MATCHES);
+}
+
+// Function to know whether matches were found past MAX_MATCHES
+bool RegexSearch::isCut() const {
+    return found.load() > MAX_MATCHES;
+}
+
+// Function to build the text that replaces a match
+string RegexSearch::format(const string& line, size_t lineOffset, const Match& match, const string& replacement) const {
+    const char* begin = line.data();
+    const char* start = begin + (match.offset - lineOffset);
+    if (line.size() > MAX_SEARCHED_COLUMNS) {
+        return string(start, match.length);  // The search skipped this line, running the expression on it could crash
+    }
+    // Like the worker's iterator, the characters before the match can be looked at
+    auto flags = regex_constants::match_continuous;
+    if (start > begin) {
+        flags |= regex_constants::match_prev_avail;
+    }
+    cmatch found;
+    bool same = regex_search(start, begin + line.size(), found, expression, flags) && static_cast<size_t>(found.length(0)) == match.length;
+    // After an empty match the iterator looks for a longer one at the same place (not tried first: libstdc++
+    // also applies match_not_null to the lookaheads, which then never match at the end of the line)
+    if (!same && found.length(0) == 0) {
+        same = regex_search(start, begin + line.size(), found, expression, flags | regex_constants::match_not_null)
+               && static_cast<size_t>(found.length(0)) == match.length;
+    }
+    return same ? found.format(replacement) : string(start, match.length);
+}
+
+// Function to get the polled matches
+const vector<RegexSearch::Match>& RegexSearch::getMatches() const {
+    return matches;
+}
+
+// Function to find the first match at or after offset, wrapping around to the first match
+bool RegexSearch::next(size_t offset, Match& match) const {
+    if (matches.empty()) {
+        return false;
+    }
+    auto found = lower_bound(matches.begin(), matches.end(), offset, [](const Match& m, size_t o) { return m.offset < o; });
+    match = found != matches.end() ? *found : matches.front();
+    return true;
+}
+
+// Function to find the last match before offset, wrapping around to the last match
+bool RegexSearch::previous(size_t offset, Match& match) const {
+    if (matches.empty()) {
+        return false;
+    }
+    auto found = lower_bound(matches.begin(), matches.end(), offset, [](const Match& m, size_t o) { return m.offset < o; });
+    match = found != matches.begin() ? *(found - 1) : matches.back();
+    return true;
+}
+
+// Function to stop the worker and wait for it
+void RegexSearch::stop() {
+    stopRequested.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+    stopRequested.store(false);
+    finished.store(true);
+}
+
+// Function run by the worker to search every line of the snapshot, in order
+void RegexSearch::searchSnapshot() {
+    vector<Match> batch;
+    string carry;            // Start of a line that continues in the next span (one character past the limit at most)
+    size_t carryOffset = 0;  // Document offset of that line
+    size_t offset = 0;       // Document offset of the current span
+    size_t published = 0;    // Searched characters when the last batch was handed over
+
+    for (const auto& span : text.spans) {
+        const char* data = span.first;
+        const char* end = data + span.second;
+        const char* cursor = data;
+        while (cursor < end) {
+            if (stopRequested.load(memory_order_relaxed)) {
+                return;  // A new search was started (the matches of this one are dropped)
+            }
+            const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+            if (!lineEnd) {
+                // The line goes on in the next span; only these lines are copied
+                if (carry.empty()) {
+                    carryOffset = offset + (cursor - data);
+                }
+                carry.append(cursor, min<size_t>(end - cursor, MAX_SEARCHED_COLUMNS + 1 - carry.size()));
+                break;
+            }
+            if (!carry.empty()) {
+                carry.append(cursor, min<size_t>(lineEnd - cursor, MAX_SEARCHED_COLUMNS + 1 - carry.size()));
+                searchLine(carry.data(), carry.data() + carry.size(), carryOffset, batch);
+                carry.clear();
+            } else {
+                searchLine(cursor, lineEnd, offset + (cursor - data), batch);  // Searched in place
+            }
+            cursor = lineEnd + 1;
+
+            size_t searched = offset + (cursor - data);
+            searchedBytes.store(searched, memory_order_relaxed);
+            if (batch.size() >= PUBLISH_MATCHES || searched - published >= PUBLISH_BYTES) {
+                publish(batch);
+                published = searched;
+            }
+        }
+        offset += span.second;
+    }
+    // The last line has no '\n'
+    if (!carry.empty()) {
+        searchLine(carry.data(), carry.data() + carry.size(), carryOffset, batch);
+    }
+    publish(batch);
+    searchedBytes.store(text.length);
+    finished.store(true);
+}
+
+// Function to append the matches of one line to batch
+void RegexSearch::searchLine(const char* begin, const char* end, size_t offset, vector<Match>& batch) {
+    if (static_cast<size_t>(end - begin) > MAX_SEARCHED_COLUMNS) {
+        skipped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    for (cregex_iterator match(begin, end, expression), last; match != last; ++match) {
+        size_t length = match->length(0);
+        if (length == 0) {
+            continue;  // Nothing to highlight or to jump to
+        }
+        // Past MAX_MATCHES the matches are only counted
+        if (found.fetch_add(1, memory_order_relaxed) < MAX_MATCHES) {
+            batch.push_back(Match{offset + match->position(0), length});
+        }
+    }
+}
+
+// Function to hand a batch of matches over to the editor
+void RegexSearch::publish(vector<Match>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    lock_guard<mutex> lock(pendingMutex);
+    pending.insert(pending.end(), batch.begin(), batch.end());
+    batch.clear();
+}
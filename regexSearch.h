@@ -0,0 +1,104 @@
+#ifndef REGEXSEARCH_H
+#define REGEXSEARCH_H
+
+#include <string>
+#include <vector>   // For the matches
+#include <cstddef>  // For size_t
+#include <regex>    // For the compiled expression
+#include <atomic>   // For the progress shared with the search thread
+#include <mutex>    // For the matches handed over by the search thread
+#include <thread>   // For searching in the background
+#include "pieceTable.h" // For the snapshot that is searched
+
+// RegexSearch class to find the matches of a regular expression on a worker thread
+// The worker reads a snapshot of the document, so the editor keeps running (and editing) while it
+// searches. The matches are handed over in batches and poll() adds them to getMatches() every frame, so
+// the first results and the running count show up long before the end of a large file is reached.
+// Starting a new search stops the previous one; the worker checks for that after every line.
+// Matches do not span lines: the expression is applied to one line at a time, so ^ and $ match at line ends.
+// Lines longer than MAX_SEARCHED_COLUMNS are skipped and counted: std::regex recurses for every character it
+// matches, and a line of a few ten thousand characters overflows the stack of the thread running it.
+class RegexSearch {
+public:
+    // Match struct to describe one match in the document
+    struct Match {
+        size_t offset;  // Document offset of the first character
+        size_t length;  // Number of characters (never 0, empty matches are skipped)
+    };
+
+    // Constructor to create a search without a pattern
+    RegexSearch();
+    // Destructor to stop the search thread
+    ~RegexSearch();
+
+    // The search thread works on this object, so it cannot be copied
+    RegexSearch(const RegexSearch&) = delete;
+    RegexSearch& operator=(const RegexSearch&) = delete;
+
+    // Method to start searching a snapshot of the document for an expression, stopping the previous search
+    // It returns false (and searches nothing) when the expression is not valid.
+    bool start(const PieceTable& document, const std::string& pattern);
+    // Method to stop the search and forget the pattern and every match
+    void clear();
+    // Method to move the matches found by the worker since the last call into getMatches() (call it once per frame)
+    void poll();
+
+    // Method to get the current pattern
+    const std::string& getPattern() const;
+    // Method to know whether the pattern is a valid expression
+    bool isValid() const;
+    // Method to know whether the worker is still searching
+    bool isSearching() const;
+    // Method to get the fraction of the snapshot searched so far (0 to 1)
+    float progress() const;
+    // Method to get the number of matches found so far, including the ones not polled yet
+    size_t foundCount() const;
+    // Method to get the number of lines skipped so far because they are longer than MAX_SEARCHED_COLUMNS
+    size_t skippedCount() const;
+    // Method to know whether the search is over and every match it kept is in getMatches()
+    bool isComplete() const;
+    // Method to know whether more than MAX_MATCHES matches were found (the ones after were only counted)
+    bool isCut() const;
+    // Method to build the text that replaces a match: $& is the match and $1 to $9 its groups
+    // The expression is applied again at the match inside the line that holds it (lineOffset is the document
+    // offset of that line), so \b, ^, $ and lookaheads see the text they saw during the search.
+    // When it no longer matches there, the text of the match is returned unchanged.
+    std::string format(const std::string& line, size_t lineOffset, const Match& match, const std::string& replacement) const;
+
+    // Method to get the polled matches, sorted by offset
+    const std::vector<Match>& getMatches() const;
+    // Methods to find the first match after offset and the last match before offset, wrapping around
+    // They return false when there is no match.
+    bool next(size_t offset, Match& match) const;
+    bool previous(size_t offset, Match& match) const;
+
+    static const size_t MAX_MATCHES = 1 << 22; // Matches kept at most; the ones after are only counted
+    static const size_t MAX_SEARCHED_COLUMNS = 2000; // Longer lines are not searched (every pattern tried runs at 4096)
+
+private:
+    std::string pattern;          // Expression searched for
+    bool valid;                   // False when the expression could not be compiled
+    std::regex expression;        // Compiled expression, only read by the worker while it runs
+    TextSnapshot text;            // Version of the document the worker searches
+    std::vector<Match> matches;   // Matches already handed to the editor
+
+    std::thread worker;                 // Thread searching the snapshot
+    std::atomic<bool> stopRequested;    // Set to ask the worker to stop after the current line
+    std::atomic<bool> finished;         // Set by the worker when it is done
+    std::atomic<size_t> searchedBytes;  // Characters of the snapshot searched so far
+    std::atomic<size_t> found;          // Matches found so far
+    std::atomic<size_t> skipped;        // Lines too long to search so far
+    std::mutex pendingMutex;            // Protects pending
+    std::vector<Match> pending;         // Matches found by the worker and not polled yet
+
+    // Helper to stop the worker and wait for it
+    void stop();
+    // Helper run by the worker to search every line of the snapshot
+    void searchSnapshot();
+    // Helper to append the matches of one line to batch (a line longer than MAX_SEARCHED_COLUMNS is only counted)
+    void searchLine(const char* begin, const char* end, size_t offset, std::vector<Match>& batch);
+    // Helper to hand a batch of matches over to the editor
+    void publish(std::vector<Match>& batch);
+};
+
+#endif // REGEXSEARCH_H
@@ -0,0 +1,367 @@
+#include    "notepad.h"    // Include the header file for the TextEditor class
+#include    "eventLog.h"   // Include the header file for recorded sessions
+#include    <algorithm>    // For sort when computing percentiles
+#include    <chrono>       // For high resolution timing
+#include    <cstdio>       // For remove
+#include    <fstream>      // For writing the input file and reading the checked output
+#include    <iterator>     // For reading a whole file into a string
+#include    <iostream>     // Include iostream for the report
+#include    <map>          // For the samples of every kind of operation
+#include    <random>       // For random typing
+#include    <string>
+#include    <thread>       // For waiting on the journal flush
+#include    <vector>
+#ifdef _WIN32
+#include    <windows.h>    // For GetProcessMemoryInfo
+#include    <psapi.h>
+#else
+#include    <sys/resource.h> // For getrusage
+#endif
+using namespace std; // Use the standard namespace for convenience
+
+// Benchmark that drives a TextEditor with sf::Event streams without opening a window
+// Usage: ./replayBenchmark [size in MB]        synthetic session on a generated file (10 MB by default)
+//        ./replayBenchmark --replay <file>     session recorded with ./TextEditor --record <file>
+// Build: g++ -std=c++17 -O2 -o replayBenchmark replayBenchmark.cpp eventLog.cpp notepad.cpp documentSearch.cpp regexSearch.cpp
+//            fileSaver.cpp recoveryJournal.cpp syntaxHighlighter.cpp undoJournal.cpp pieceTable.cpp lineIndex.cpp textScan.cpp mappedFile.cpp textRenderer.cpp trace.cpp -pthread -lsfml-graphics -lsfml-window -lsfml-system
+
+typedef chrono::steady_clock Clock;
+
+// Function to get the peak resident memory of the process in bytes
+static size_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;  // Already in bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // Kilobytes on Linux
+#endif
+#endif
+}
+
+// Function to print the latency summary of one kind of operation
+static void report(const string& name, vector<double>& samples) {
+    sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    cout << name << ": " << samples.size() << " ops"
+         << "  avg " << total / samples.size() << " us"
+         << "  p50 " << samples[samples.size() / 2] << " us"
+         << "  p99 " << samples[samples.size() * 99 / 100] << " us"
+         << "  max " << samples.back() << " us"
+         << "  " << samples.size() / (total / 1e6) << " ops/s\n";
+}
+
+// Function to name the kind of operation a step performs
+static string kindOf(const ReplayStep& step) {
+    if (step.kind == ReplayStep::OPEN) {
+        return "open";
+    }
+    if (step.kind == ReplayStep::SAVE) {
+        return "save";
+    }
+    if (step.kind == ReplayStep::PASTE) {
+        return "paste";
+    }
+    const sf::Event& event = step.event;
+    if (event.type == sf::Event::TextEntered) {
+        if (event.text.unicode == '\b') {
+            return "backspace";
+        }
+        return event.text.unicode == '\r' || event.text.unicode == '\n' ? "newline" : "typing";
+    }
+    if (event.type == sf::Event::KeyPressed) {
+        if (event.key.control && (event.key.code == sf::Keyboard::Y || (event.key.code == sf::Keyboard::Z && event.key.shift))) {
+            return "redo";
+        }
+        if (event.key.control && event.key.code == sf::Keyboard::Z) {
+            return "undo";
+        }
+        return "cursor";
+    }
+    if (event.type == sf::Event::KeyReleased) {
+        return "key release";  // Only recorded for Shift, kept apart so it does not dilute the cursor keys
+    }
+    return "scroll";
+}
+
+// Helpers to build the events of a synthetic session
+static ReplayStep textStep(uint32_t unicode) {
+    ReplayStep step;
+    step.kind = ReplayStep::EVENT;
+    step.event = sf::Event();
+    step.event.type = sf::Event::TextEntered;
+    step.event.text.unicode = unicode;
+    return step;
+}
+
+static ReplayStep keyStep(sf::Keyboard::Key code, bool control = false, bool shift = false) {
+    ReplayStep step;
+    step.kind = ReplayStep::EVENT;
+    step.event = sf::Event();
+    step.event.type = sf::Event::KeyPressed;
+    step.event.key.code = code;
+    step.event.key.control = control;
+    step.event.key.shift = shift;
+    return step;
+}
+
+static ReplayStep fileStep(ReplayStep::Kind kind, const string& filename) {
+    ReplayStep step;
+    step.kind = kind;
+    step.event = sf::Event();
+    step.filename = filename;
+    return step;
+}
+
+static ReplayStep pasteStep(string text) {
+    ReplayStep step;
+    step.kind = ReplayStep::PASTE;
+    step.event = sf::Event();
+    step.text = move(text);
+    return step;
+}
+
+// Function to build a session covering typing bursts, backspace storms, line splits, undo chains, a large paste,
+// open and save
+static vector<ReplayStep> syntheticSession(const string& inputName, const string& outputName) {
+    vector<ReplayStep> steps;
+    mt19937 random(42);
+    steps.push_back(fileStep(ReplayStep::OPEN, inputName));
+
+    for (int round = 0; round < 200; round++) {
+        // Jump a page down and into the middle of the line
+        steps.push_back(keyStep(sf::Keyboard::PageDown));
+        for (int i = 0; i < 20; i++) {
+            steps.push_back(keyStep(sf::Keyboard::Right));
+        }
+        // Typing burst
+        for (int i = 0; i < 100; i++) {
+            steps.push_back(textStep('a' + random() % 26));
+        }
+        // Split the line a few times, typing on every new line
+        for (int i = 0; i < 5; i++) {
+            steps.push_back(textStep('\r'));
+            for (int j = 0; j < 10; j++) {
+                steps.push_back(textStep('a' + random() % 26));
+            }
+        }
+        // Backspace storm that also merges the split lines back
+        for (int i = 0; i < 150; i++) {
+            steps.push_back(textStep('\b'));
+        }
+        // Undo chain followed by a redo chain
+        for (int i = 0; i < 15; i++) {
+            steps.push_back(keyStep(sf::Keyboard::Z, true));
+        }
+        for (int i = 0; i < 15; i++) {
+            steps.push_back(keyStep(sf::Keyboard::Y, true));
+        }
+    }
+
+    // Paste 10 MB of short lines, then undo and redo it
+    string clipboard;
+    while (clipboard.size() < (10u << 20)) {
+        clipboard += "pasted line " + to_string(clipboard.size()) + "\n";
+    }
+    steps.push_back(pasteStep(move(clipboard)));
+    steps.push_back(keyStep(sf::Keyboard::Z, true));
+    steps.push_back(keyStep(sf::Keyboard::Y, true));
+
+    steps.push_back(fileStep(ReplayStep::SAVE, outputName));
+    return steps;
+}
+
+// Function to check that a regex search skips a line longer than RegexSearch::MAX_SEARCHED_COLUMNS
+// std::regex recurses for every character it matches, so searching the whole line would overflow the stack.
+static bool checkLongLineSearch() {
+    const string inputName = "replay_long_line.txt";
+    const string outputName = "replay_long_line_out.txt";
+    string longLine(100000, 'a');
+    {
+        ofstream input(inputName, ios::binary);
+        input << longLine << "\nshort aaa line\n";
+    }
+
+    bool passed = false;
+    {
+        TextEditor editor(false);
+        editor.readFromFile(inputName);
+        while (editor.isLoading()) {
+            editor.update();
+        }
+        // Ctrl+F, Ctrl+R, "a+" in the find field, Tab, "b" in the replace field, Ctrl+Enter
+        vector<ReplayStep> steps = {keyStep(sf::Keyboard::F, true), keyStep(sf::Keyboard::R, true), textStep('a'), textStep('+'),
+                                    keyStep(sf::Keyboard::Tab), textStep('b'), keyStep(sf::Keyboard::Enter, true)};
+        for (const ReplayStep& step : steps) {
+            sf::Event event = step.event;
+            editor.handleInput(event);
+            editor.update();
+        }
+        while (editor.isSearching()) {
+            editor.update();
+        }
+        editor.saveToFile(outputName);
+        while (editor.isSaving()) {
+            editor.update();
+        }
+        editor.update();
+
+        // The long line is left as it is, the short one is replaced
+        ifstream output(outputName, ios::binary);
+        string saved((istreambuf_iterator<char>(output)), istreambuf_iterator<char>());
+        passed = saved == longLine + "\nshort b line\n";
+    }
+    remove(inputName.c_str());
+    remove(outputName.c_str());
+    cout << "Check long line regex search: " << (passed ? "ok" : "FAILED") << "\n";
+    return passed;
+}
+
+// Function to check that typing after a cancelled open is recovered onto an empty document
+// The journal was based on the cancelled file, so a crash used to replay the typing into that file.
+static bool checkCancelledOpenRecovery() {
+    const string inputName = "replay_cancelled.txt";
+    const string journalName = "replay_check.journal";
+    const string crashedName = "replay_crashed.journal";
+    {
+        ofstream input(inputName, ios::binary);
+        string line(99, 'x');
+        for (int i = 0; i < 500000; i++) {
+            input << line << '\n';  // 50 MB, still being indexed when Escape comes
+        }
+    }
+
+    bool passed = false;
+    bool cancelled = false;
+    {
+        TextEditor editor(false);
+        editor.startRecovery(journalName);
+        editor.readFromFile(inputName);
+        vector<ReplayStep> steps = {keyStep(sf::Keyboard::Escape), textStep('h'), textStep('e'), textStep('l'), textStep('l'), textStep('o')};
+        for (const ReplayStep& step : steps) {
+            sf::Event event = step.event;
+            editor.handleInput(event);
+            editor.update();
+        }
+        cancelled = editor.documentBytes() == 5;
+        // Keep a copy of the journal once the flush thread wrote the typing, as a crash would leave it
+        JournalContents contents;
+        for (int wait = 0; wait < 500 && !(RecoveryJournal::read(journalName, contents) && contents.edits.size() == 5); wait++) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        ifstream journal(journalName, ios::binary);
+        ofstream crashed(crashedName, ios::binary);
+        crashed << journal.rdbuf();
+    }
+    if (cancelled) {
+        TextEditor recovered(false);
+        passed = recovered.startRecovery(crashedName) && recovered.documentBytes() == 5;
+    }
+    remove(inputName.c_str());
+    remove(journalName.c_str());
+    remove(crashedName.c_str());
+    cout << "Check typing after a cancelled open is recovered: " << (cancelled ? (passed ? "ok" : "FAILED") : "not run, the file opened before Escape") << "\n";
+    return passed || !cancelled;
+}
+
+// Function to feed every step into a TextEditor and time it, returns the total time in microseconds
+// Every save writes saveName, never the file the recorded session saved (notepad.txt in the working directory).
+static double replay(const vector<ReplayStep>& steps, const string& saveName, map<string, vector<double>>& samples) {
+    // The editor is created without its font, so it needs no window or graphics context
+    TextEditor editor(false);
+    double totalTime = 0;
+
+    for (const ReplayStep& step : steps) {
+        Clock::time_point start = Clock::now();
+        if (step.kind == ReplayStep::OPEN) {
+            // Opening counts until the whole file is indexed, the way the editor's frames would see it
+            editor.readFromFile(step.filename);
+            while (editor.isLoading()) {
+                editor.update();
+            }
+        } else if (step.kind == ReplayStep::SAVE) {
+            // Saving counts until the file is on disk, although the editor's frames keep running meanwhile
+            editor.saveToFile(saveName);
+            while (editor.isSaving()) {
+                editor.update();
+            }
+            editor.update();  // Reports the result
+        } else if (step.kind == ReplayStep::PASTE) {
+            editor.insertText(step.text);
+            editor.update();
+        } else {
+            sf::Event event = step.event;
+            editor.handleInput(event);
+            editor.update();  // Every event is followed by a frame update in the editor's loop
+        }
+        double elapsed = chrono::duration<double, micro>(Clock::now() - start).count();
+        samples[kindOf(step)].push_back(elapsed);
+        totalTime += elapsed;
+    }
+    return totalTime;
+}
+
+int main(int argc, char** argv) {
+    vector<ReplayStep> steps;
+    const string inputName = "replay_input.txt";
+    const string outputName = "replay_output.txt";
+    bool synthetic = !(argc > 2 && string(argv[1]) == "--replay");
+
+    if (synthetic) {
+        // Write a document of 60 character lines (10 MB by default)
+        size_t megabytes = argc > 1 ? stoul(argv[1]) : 10;
+        ofstream input(inputName, ios::binary);
+        mt19937 random(7);
+        string line(60, '\n');
+        for (size_t written = 0; written < (megabytes << 20); written += line.size()) {
+            for (size_t i = 0; i + 1 < line.size(); i++) {
+                line[i] = static_cast<char>('a' + random() % 26);
+            }
+            input.write(line.data(), line.size());
+        }
+        input.close();
+        steps = syntheticSession(inputName, outputName);
+    } else if (!EventLog::load(argv[2], steps)) {
+        cerr << "Failed to read " << argv[2] << endl;
+        return 1;
+    } else {
+        // Sessions recorded before saves were logged have the Ctrl+S key press instead: it is timed as a save too
+        for (ReplayStep& step : steps) {
+            const sf::Event& event = step.event;
+            if (step.kind == ReplayStep::EVENT && event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::S && event.key.control) {
+                step = fileStep(ReplayStep::SAVE, TextEditor::SAVE_FILE);
+            }
+        }
+    }
+
+    // The editor is destroyed inside replay, before the input file is removed, since the document maps it
+    map<string, vector<double>> samples;
+    double totalTime = replay(steps, outputName, samples);
+
+    cout << "Replayed " << steps.size() << " steps in " << totalTime / 1000 << " ms ("
+         << steps.size() / (totalTime / 1e6) << " steps/s)\n";
+    for (auto& kind : samples) {
+        report(kind.first, kind.second);
+    }
+    cout << "Peak resident memory: " << peakResidentBytes() / (1024.0 * 1024.0) << " MB\n";
+
+    bool passed = true;
+    remove(outputName.c_str());
+    if (synthetic) {
+        remove(inputName.c_str());
+        // The synthetic run also checks the cases that used to break the editor
+        passed = checkLongLineSearch();
+        passed = checkCancelledOpenRecovery() && passed;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include    "textScan.h"  // Include the header file for the scanning kernels
+#include    <algorithm>   // For min
+#include    <chrono>      // For high resolution timing
+#include    <iostream>    // Include iostream for the report
+#include    <random>      // For random line lengths
+#include    <string>
+#include    <vector>
+using namespace std; // Use the standard namespace for convenience
+
+// Microbenchmark of the scanning kernels against the byte-at-a-time loops they replace
+// Build: g++ -std=c++17 -O2 -o scanBenchmark scanBenchmark.cpp textScan.cpp
+
+typedef chrono::steady_clock Clock;
+const size_t CHUNK = 1 << 20;  // Same chunk size as the line index
+
+// Function to time the best of three runs of a job, in seconds
+template <typename Job>
+static double bestOfThree(Job job) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        Clock::time_point start = Clock::now();
+        job();
+        best = min(best, chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+// Function to print one result line
+static void report(const string& job, const string& version, size_t bytes, double seconds, size_t result) {
+    cout << job << " [" << version << "]: " << seconds * 1000 << " ms, " << bytes / seconds / 1e9 << " GB/s (result " << result << ")\n";
+}
+
+int main(int argc, char** argv) {
+    // Size of the text in megabytes (256 MB by default), lines of 1 to 120 characters
+    size_t megabytes = argc > 1 ? stoul(argv[1]) : 256;
+    string text;
+    text.reserve(megabytes << 20);
+    mt19937 random(42);
+    while (text.size() < (megabytes << 20)) {
+        size_t length = 1 + random() % 120;
+        for (size_t i = 0; i < length; i++) {
+            text += static_cast<char>('a' + random() % 26);
+        }
+        text += '\n';
+    }
+    const char* data = text.data();
+    size_t size = text.size();
+    const string pattern = "needle!";  // Not in the text, so every search scans the whole buffer
+    volatile size_t sink = 0;         // Keeps the compiler from removing the loops
+
+    // Byte-at-a-time versions, the way the text used to be scanned
+    size_t result = 0;
+    double seconds = bestOfThree([&] {
+        size_t count = 0;
+        for (size_t i = 0; i < size; i++) {
+            count += data[i] == '\n';
+        }
+        result = count;
+    });
+    report("count line feeds", "byte loop", size, seconds, result);
+
+    vector<uint32_t> positions;
+    seconds = bestOfThree([&] {
+        size_t found = 0;
+        for (size_t start = 0; start < size; start += CHUNK) {
+            positions.clear();
+            size_t end = min(size, start + CHUNK);
+            for (size_t i = start; i < end; i++) {
+                if (data[i] == '\n') {
+                    positions.push_back(static_cast<uint32_t>(i - start));
+                }
+            }
+            found += positions.size();
+        }
+        result = found;
+    });
+    report("find line feeds", "byte loop", size, seconds, result);
+
+    seconds = bestOfThree([&] {
+        size_t found = size;
+        for (size_t i = 0; i + pattern.size() <= size; i++) {
+            size_t j = 0;
+            while (j < pattern.size() && data[i + j] == pattern[j]) {
+                j++;
+            }
+            if (j == pattern.size()) {
+                found = i;
+                break;
+            }
+        }
+        result = found;
+    });
+    report("find pattern", "byte loop", size, seconds, result);
+
+    // Every implementation of the kernels the processor supports
+    TextScan::Implementation implementations[] = {TextScan::SCALAR, TextScan::SSE2, TextScan::AVX2};
+    for (TextScan::Implementation implementation : implementations) {
+        if (!TextScan::select(implementation)) {
+            continue;
+        }
+        string version = TextScan::name(implementation);
+
+        seconds = bestOfThree([&] { result = TextScan::count(data, size, '\n'); });
+        report("count line feeds", version, size, seconds, result);
+
+        seconds = bestOfThree([&] {
+            size_t found = 0;
+            for (size_t start = 0; start < size; start += CHUNK) {
+                positions.clear();
+                TextScan::findAll(data + start, min(size, start + CHUNK) - start, '\n', 0u, positions);
+                found += positions.size();
+            }
+            result = found;
+        });
+        report("find line feeds", version, size, seconds, result);
+
+        seconds = bestOfThree([&] {
+            const char* found = TextScan::find(data, size, pattern.data(), pattern.size());
+            result = found ? static_cast<size_t>(found - data) : size;
+        });
+        report("find pattern", version, size, seconds, result);
+    }
+    sink = sink + result;
+    return 0;
+}
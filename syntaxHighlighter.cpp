@@ -0,0 +1,582 @@
+#include    "syntaxHighlighter.h" // Include the header file for the syntax highlighter
+#include    <algorithm>           // For upper_bound, binary_search and min
+#include    <cstring>             // For memchr and strcmp
+using namespace std; // Use the standard namespace for convenience
+
+// Lines a block of states holds before it is cut in two
+const size_t STATE_BLOCK = 4096;
+// Lines lexed per frame after edits; if the states have not converged by then, the worker takes over
+const size_t RELEX_LINES = 2000;
+
+// Lexer states carried from one line to the next
+const uint8_t NORMAL = 0;
+const uint8_t BLOCK_COMMENT = 1;  // Inside /* */
+const uint8_t TRIPLE_DOUBLE = 2;  // Inside """ """
+const uint8_t TRIPLE_SINGLE = 3;  // Inside ''' '''
+
+// Extensions of the files with C-like syntax (// and /* */ comments, # directives)
+const char* const C_EXTENSIONS[] = {
+    "c", "cc", "cpp", "cs", "css", "cxx", "glsl", "go", "h", "hh", "hpp", "hxx", "inl", "java",
+    "js", "json", "jsx", "kt", "mjs", "rs", "scss", "swift", "ts", "tsx"
+};
+// Extensions of the scripts and configuration files (# comments, """ strings)
+const char* const SCRIPT_EXTENSIONS[] = {
+    "bash", "cfg", "cmake", "conf", "ini", "mk", "pl", "properties", "py", "rb", "sh", "toml", "yaml", "yml", "zsh"
+};
+// Keywords of the C-like languages, sorted for binary_search
+const char* const C_KEYWORDS[] = {
+    "auto", "bool", "break", "case", "catch", "char", "class", "const", "constexpr", "continue",
+    "default", "delete", "do", "double", "else", "enum", "explicit", "export", "extends", "extern",
+    "false", "final", "float", "fn", "for", "friend", "func", "function", "if", "impl", "implements",
+    "import", "inline", "int", "interface", "let", "long", "match", "mut", "namespace", "new",
+    "noexcept", "null", "nullptr", "operator", "override", "package", "private", "protected",
+    "pub", "public", "return", "short", "signed", "size_t", "static", "struct", "super", "switch",
+    "template", "this", "throw", "true", "try", "typedef", "typename", "union", "unsigned",
+    "using", "var", "virtual", "void", "volatile", "while", "yield"
+};
+// Keywords of the scripts and configuration files, sorted for binary_search
+const char* const SCRIPT_KEYWORDS[] = {
+    "False", "None", "True", "and", "as", "begin", "break", "case", "class", "continue", "def",
+    "del", "do", "done", "elif", "else", "end", "esac", "except", "export", "false", "fi",
+    "finally", "for", "from", "function", "global", "if", "import", "in", "is", "lambda", "local",
+    "module", "no", "nonlocal", "not", "null", "or", "pass", "raise", "require", "return", "then",
+    "true", "try", "while", "with", "yes", "yield"
+};
+
+// Helper to compare two C strings for binary_search
+static bool lessString(const char* left, const char* right) {
+    return strcmp(left, right) < 0;
+}
+
+// Helper to know whether a sorted list holds a word
+template <size_t N>
+static bool contains(const char* const (&list)[N], const string& word) {
+    return binary_search(list, list + N, word.c_str(), lessString);
+}
+
+// Helpers to classify the characters of identifiers and numbers
+static bool isIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$';
+}
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+static bool isIdentifierPart(char c) {
+    return isIdentifierStart(c) || isDigit(c);
+}
+
+// Helper to find a two or three character delimiter in a line, returns length when it is not there
+static size_t findDelimiter(const char* text, size_t from, size_t length, const char* delimiter) {
+    size_t size = strlen(delimiter);
+    for (size_t i = from; i + size <= length; i++) {
+        if (memcmp(text + i, delimiter, size) == 0) {
+            return i;
+        }
+    }
+    return length;
+}
+
+// Helper to add a token, when the caller wants them
+static void addToken(vector<SyntaxHighlighter::Token>* tokens, size_t start, size_t end, SyntaxHighlighter::Kind kind) {
+    if (tokens && end > start) {
+        tokens->push_back({start, end - start, kind});
+    }
+}
+
+// Constructor to create an empty list
+LineStates::LineStates() : total(0) {}
+
+// Function to get the number of lines
+size_t LineStates::size() const {
+    return total;
+}
+
+// Function to find the block that holds a line
+size_t LineStates::locate(size_t line) const {
+    return upper_bound(starts.begin(), starts.end(), line) - starts.begin() - 1;
+}
+
+// Function to read the state of a line
+uint8_t LineStates::get(size_t line) const {
+    size_t block = locate(line);
+    return blocks[block][line - starts[block]];
+}
+
+// Function to write the state of a line
+void LineStates::set(size_t line, uint8_t state) {
+    size_t block = locate(line);
+    blocks[block][line - starts[block]] = state;
+}
+
+// Function to insert count lines with the same state before a line
+void LineStates::insert(size_t line, size_t count, uint8_t state) {
+    if (count == 0) {
+        return;
+    }
+    size_t block;
+    if (blocks.empty()) {
+        blocks.emplace_back();
+        starts.push_back(0);
+        block = 0;
+    } else {
+        // A line past the end goes at the end of the last block
+        block = line < total ? locate(line) : blocks.size() - 1;
+    }
+    vector<uint8_t>& states = blocks[block];
+    states.insert(states.begin() + (line - starts[block]), count, state);
+    total += count;
+    renumber(block);
+}
+
+// Function to remove count lines starting at a line
+void LineStates::erase(size_t line, size_t count) {
+    count = min(count, total - min(line, total));
+    if (count == 0) {
+        return;
+    }
+    size_t first = locate(line);
+    size_t block = first;
+    size_t left = count;
+    while (left > 0) {
+        vector<uint8_t>& states = blocks[block];
+        size_t from = line > starts[block] ? line - starts[block] : 0;
+        size_t removed = min(left, states.size() - from);
+        states.erase(states.begin() + from, states.begin() + from + removed);
+        left -= removed;
+        block++;
+    }
+    total -= count;
+    // Drop the blocks that were emptied
+    blocks.erase(remove_if(blocks.begin() + first, blocks.begin() + block,
+                           [](const vector<uint8_t>& states) { return states.empty(); }),
+                 blocks.begin() + block);
+    renumber(first);
+}
+
+// Function to replace every state from a line on with a list of states
+void LineStates::replaceFrom(size_t line, const vector<uint8_t>& newStates) {
+    erase(line, total - min(line, total));
+    // Appended as full blocks: no block has to be cut
+    for (size_t i = 0; i < newStates.size(); i += STATE_BLOCK) {
+        blocks.emplace_back(newStates.begin() + i, newStates.begin() + min(i + STATE_BLOCK, newStates.size()));
+    }
+    total += newStates.size();
+    renumber(0);
+}
+
+// Function to remove every line
+void LineStates::clear() {
+    blocks.clear();
+    starts.clear();
+    total = 0;
+}
+
+// Function to cut the blocks that grew too big and compute the first lines again from a block on
+void LineStates::renumber(size_t fromBlock) {
+    for (size_t block = fromBlock; block < blocks.size(); block++) {
+        if (blocks[block].size() > 2 * STATE_BLOCK) {
+            // A large paste: cut the block in blocks of STATE_BLOCK lines
+            vector<uint8_t> whole = move(blocks[block]);
+            vector<vector<uint8_t>> parts;
+            for (size_t i = 0; i < whole.size(); i += STATE_BLOCK) {
+                parts.emplace_back(whole.begin() + i, whole.begin() + min(i + STATE_BLOCK, whole.size()));
+            }
+            blocks.erase(blocks.begin() + block);
+            blocks.insert(blocks.begin() + block, make_move_iterator(parts.begin()), make_move_iterator(parts.end()));
+        }
+    }
+    starts.resize(blocks.size());
+    size_t line = fromBlock > 0 && fromBlock <= blocks.size() ? starts[fromBlock - 1] + blocks[fromBlock - 1].size() : 0;
+    for (size_t block = fromBlock > blocks.size() ? blocks.size() : fromBlock; block < blocks.size(); block++) {
+        starts[block] = line;
+        line += blocks[block].size();
+    }
+}
+
+// Constructor to create a highlighter that colors nothing
+SyntaxHighlighter::SyntaxHighlighter()
+    : language(NONE), known(false), fullPassPending(false), passLine(0), passOffset(0), passState(NORMAL),
+      stopRequested(false), finished(true) {}
+
+// Destructor to stop the lexing thread
+SyntaxHighlighter::~SyntaxHighlighter() {
+    stopPass();
+}
+
+// Function to choose the language from the name of the opened file and forget every state
+void SyntaxHighlighter::setLanguage(const string& filename) {
+    stopPass();
+    states.clear();
+    dirty.clear();
+    known = false;
+
+    size_t slash = filename.find_last_of("/\\");
+    string name = filename.substr(slash == string::npos ? 0 : slash + 1);
+    size_t dot = name.rfind('.');
+    string extension = dot == string::npos ? "" : name.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return tolower(c); });
+
+    if (contains(C_EXTENSIONS, extension)) {
+        language = C_FAMILY;
+    } else if (contains(SCRIPT_EXTENSIONS, extension) || name == "Makefile" || name == "CMakeLists.txt") {
+        language = SCRIPT;
+    } else {
+        language = NONE;
+    }
+    fullPassPending = language != NONE;
+}
+
+// Function to know whether the document is highlighted
+bool SyntaxHighlighter::isActive() const {
+    return language != NONE;
+}
+
+// Function to tell the highlighter about an edit
+void SyntaxHighlighter::onEdit(size_t line, size_t removedLines, size_t addedLines) {
+    if (language == NONE) {
+        return;
+    }
+    LineEdit edit = {line, removedLines, addedLines};
+    if (isPassRunning()) {
+        passEdits.push_back(edit);  // The states are numbered as in the snapshot until the pass is merged
+    } else if (known) {
+        applyEdit(edit);
+    }
+    // Otherwise the first pass has not started yet and will see the edit
+}
+
+// Function to bring the states up to date
+bool SyntaxHighlighter::update(const PieceTable& document) {
+    if (language == NONE || document.isLoading()) {
+        return false;
+    }
+    if (fullPassPending) {
+        fullPassPending = false;
+        startPass(document, 0, NORMAL);
+        return false;
+    }
+    bool changed = false;
+    if (worker.joinable() && finished.load()) {
+        mergePass();
+        changed = true;
+    }
+    if (!isPassRunning() && relex(document, RELEX_LINES) > 0) {
+        changed = true;
+    }
+    return changed;
+}
+
+// Function to know whether update() still has work to do
+bool SyntaxHighlighter::isBusy() const {
+    return language != NONE && (fullPassPending || worker.joinable() || !dirty.empty());
+}
+
+// Function to know whether the next update() can lex lines or merge a pass
+bool SyntaxHighlighter::hasWorkReady() const {
+    if (language == NONE) {
+        return false;
+    }
+    // The edited lines wait for the running pass, which can only be merged once it is done
+    if (isPassRunning()) {
+        return finished.load();
+    }
+    return fullPassPending || !dirty.empty();
+}
+
+// Function to get the state a line starts in
+uint8_t SyntaxHighlighter::stateBefore(size_t line) const {
+    // While a pass runs the states may be numbered as in its snapshot: close enough for a few frames
+    if (line == 0 || !known || line - 1 >= states.size()) {
+        return NORMAL;
+    }
+    return states.get(line - 1);
+}
+
+// Function to lex a line of the document into tokens
+uint8_t SyntaxHighlighter::lineTokens(const PieceTable& document, size_t line, uint8_t state, vector<Token>& tokens) const {
+    tokens.clear();
+    if (language == NONE || document.lineLength(line) > MAX_LEXED_COLUMNS) {
+        return state;
+    }
+    string text = document.getLine(line);
+    return lexLine(language, text.data(), text.size(), state, &tokens);
+}
+
+// Function to lex one line of the document and return its end state
+uint8_t SyntaxHighlighter::lexDocumentLine(const PieceTable& document, size_t line, uint8_t state) const {
+    if (document.lineLength(line) > MAX_LEXED_COLUMNS) {
+        return state;
+    }
+    string text = document.getLine(line);
+    return lexLine(language, text.data(), text.size(), state, nullptr);
+}
+
+// Function to lex one line of text
+uint8_t SyntaxHighlighter::lexLine(Language language, const char* text, size_t length, uint8_t state, vector<Token>* tokens) {
+    if (length > MAX_LEXED_COLUMNS) {
+        return state;  // Same rule as for the lines of the document, so the worker agrees with the editor
+    }
+    size_t i = 0;
+
+    // Finish the comment or string the previous line left open
+    if (state != NORMAL) {
+        const char* closing = state == BLOCK_COMMENT ? "*/" : state == TRIPLE_DOUBLE ? "\"\"\"" : "'''";
+        size_t end = findDelimiter(text, 0, length, closing);
+        Kind kind = state == BLOCK_COMMENT ? COMMENT : STRING;
+        if (end == length) {
+            addToken(tokens, 0, length, kind);
+            return state;
+        }
+        i = end + strlen(closing);
+        addToken(tokens, 0, i, kind);
+        state = NORMAL;
+    }
+
+    // Column of the first character that is not a space, for the directives and line comments
+    size_t first = 0;
+    while (first < length && (text[first] == ' ' || text[first] == '\t')) {
+        first++;
+    }
+
+    while (i < length) {
+        char c = text[i];
+        size_t start = i;
+        if (language == C_FAMILY && c == '/' && i + 1 < length && text[i + 1] == '/') {
+            addToken(tokens, i, length, COMMENT);
+            break;
+        }
+        if (language == C_FAMILY && c == '/' && i + 1 < length && text[i + 1] == '*') {
+            size_t end = findDelimiter(text, i + 2, length, "*/");
+            if (end == length) {
+                addToken(tokens, i, length, COMMENT);
+                return BLOCK_COMMENT;
+            }
+            i = end + 2;
+            addToken(tokens, start, i, COMMENT);
+            continue;
+        }
+        if (language == SCRIPT && (c == '#' || (c == ';' && i == first))) {
+            addToken(tokens, i, length, COMMENT);
+            break;
+        }
+        if (c == '#' && i == first) {
+            // Preprocessor directive: the # and the word after it
+            i++;
+            while (i < length && isIdentifierPart(text[i])) {
+                i++;
+            }
+            addToken(tokens, start, i, DIRECTIVE);
+            continue;
+        }
+        if (language == SCRIPT && c == '[' && i == first) {
+            // Section of a configuration file
+            size_t end = findDelimiter(text, i, length, "]");
+            i = end == length ? length : end + 1;
+            addToken(tokens, start, i, DIRECTIVE);
+            continue;
+        }
+        if (language == SCRIPT && (c == '"' || c == '\'') && i + 2 < length && text[i + 1] == c && text[i + 2] == c) {
+            const char* closing = c == '"' ? "\"\"\"" : "'''";
+            size_t end = findDelimiter(text, i + 3, length, closing);
+            if (end == length) {
+                addToken(tokens, i, length, STRING);
+                return c == '"' ? TRIPLE_DOUBLE : TRIPLE_SINGLE;
+            }
+            i = end + 3;
+            addToken(tokens, start, i, STRING);
+            continue;
+        }
+        if (c == '"' || c == '\'' || c == '`') {
+            // A string ends at the next unescaped quote, or at the end of the line
+            i++;
+            while (i < length && text[i] != c) {
+                i += text[i] == '\\' ? 2 : 1;
+            }
+            i = min(i + 1, length);
+            addToken(tokens, start, i, STRING);
+            continue;
+        }
+        if (isDigit(c) || (c == '.' && i + 1 < length && isDigit(text[i + 1]))) {
+            // Numbers with their base, digit separators and suffixes
+            while (i < length && (isIdentifierPart(text[i]) || text[i] == '.' || text[i] == '\'')) {
+                i++;
+            }
+            addToken(tokens, start, i, NUMBER);
+            continue;
+        }
+        if (isIdentifierStart(c)) {
+            while (i < length && isIdentifierPart(text[i])) {
+                i++;
+            }
+            // Only the lines that are drawn ask for tokens, so the word is only looked up for them
+            if (tokens) {
+                string word(text + start, i - start);
+                if (language == C_FAMILY ? contains(C_KEYWORDS, word) : contains(SCRIPT_KEYWORDS, word)) {
+                    addToken(tokens, start, i, KEYWORD);
+                }
+            }
+            continue;
+        }
+        i++;
+    }
+    return NORMAL;
+}
+
+// Function to apply an edit to the states and mark the lines to lex again
+void SyntaxHighlighter::applyEdit(const LineEdit& edit) {
+    // The last line of the edit ends with the text the last removed line ended with: it keeps that line's
+    // state, which relex compares against to know whether the lines after the edit need lexing again
+    states.erase(edit.line, edit.removed);
+    states.insert(edit.line, edit.added, NORMAL);
+
+    // Move the ranges after the edit; a range inside the removed lines shrinks to the edited line
+    auto shift = [&](size_t line) {
+        if (line <= edit.line) {
+            return line;
+        }
+        if (line <= edit.line + edit.removed) {
+            return edit.line;
+        }
+        return line - edit.removed + edit.added;
+    };
+    map<size_t, size_t> moved;
+    for (const auto& range : dirty) {
+        size_t first = shift(range.first);
+        size_t last = shift(range.second);
+        auto found = moved.find(first);
+        moved[first] = found != moved.end() ? max(found->second, last) : last;
+    }
+    dirty.swap(moved);
+
+    // The edited line and the new lines after it
+    size_t last = edit.line + edit.added;
+    auto found = dirty.find(edit.line);
+    dirty[edit.line] = found != dirty.end() ? max(found->second, last) : last;
+}
+
+// Function to lex the dirty lines until their states converge
+size_t SyntaxHighlighter::relex(const PieceTable& document, size_t budget) {
+    size_t lexed = 0;
+    while (!dirty.empty()) {
+        size_t line = dirty.begin()->first;
+        size_t last = dirty.begin()->second;
+        dirty.erase(dirty.begin());
+        uint8_t state = line == 0 ? NORMAL : states.get(line - 1);
+        for (; line < states.size(); line++) {
+            // A range starting here is lexed in the same run
+            if (!dirty.empty() && dirty.begin()->first <= line) {
+                last = max(last, dirty.begin()->second);
+                dirty.erase(dirty.begin());
+            }
+            if (lexed == budget) {
+                // The change reaches far (a comment was opened): the worker lexes the rest of the file
+                startPass(document, line, state);
+                return lexed;
+            }
+            uint8_t end = lexDocumentLine(document, line, state);
+            uint8_t old = states.get(line);
+            states.set(line, end);
+            lexed++;
+            if (line >= last && end == old) {
+                break;  // The lines after this one start in the same state as before
+            }
+            state = end;
+        }
+    }
+    return lexed;
+}
+
+// Function to start the worker on every line from a line on
+void SyntaxHighlighter::startPass(const PieceTable& document, size_t line, uint8_t state) {
+    stopPass();
+    dirty.clear();  // Every line from the first dirty one on is lexed by the worker
+    passEdits.clear();
+    passStates.clear();
+    passLine = line;
+    passOffset = document.lineStart(line);
+    passState = state;
+    // The worker only reads the snapshot, never the document, so the editor can keep editing it
+    document.snapshot(text);
+    finished.store(false);
+    worker = thread(&SyntaxHighlighter::lexSnapshot, this);
+}
+
+// Function to stop the worker and drop what it lexed
+void SyntaxHighlighter::stopPass() {
+    stopRequested.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+    stopRequested.store(false);
+    finished.store(true);
+    text = TextSnapshot();  // Release the buffers the snapshot shares
+}
+
+// Function to know whether the worker is running
+bool SyntaxHighlighter::isPassRunning() const {
+    return worker.joinable();
+}
+
+// Function to take the result of the worker and apply the edits made meanwhile
+void SyntaxHighlighter::mergePass() {
+    worker.join();
+    text = TextSnapshot();
+    states.replaceFrom(passLine, passStates);
+    passStates = vector<uint8_t>();
+    known = true;
+    for (const LineEdit& edit : passEdits) {
+        applyEdit(edit);
+    }
+    passEdits.clear();
+}
+
+// Function run by the worker to lex every line of the snapshot from passLine on
+void SyntaxHighlighter::lexSnapshot() {
+    string carry;            // Start of a line that continues in the next span
+    size_t carryLength = 0;  // Length of that line (only its first characters are kept when it is too long to lex)
+    size_t offset = 0;       // Document offset of the current span
+    uint8_t state = passState;
+
+    for (const auto& span : text.spans) {
+        if (offset + span.second <= passOffset) {
+            offset += span.second;
+            continue;  // Before the first line to lex
+        }
+        const char* data = span.first;
+        const char* end = data + span.second;
+        const char* cursor = data + (passOffset > offset ? passOffset - offset : 0);
+        while (cursor < end) {
+            if (stopRequested.load(memory_order_relaxed)) {
+                return;
+            }
+            const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+            if (!lineEnd) {
+                // The line goes on in the next span; only these lines are copied, and never past the lexed length
+                size_t count = end - cursor;
+                if (carryLength <= MAX_LEXED_COLUMNS) {
+                    carry.append(cursor, min(count, MAX_LEXED_COLUMNS + 1 - carry.size()));
+                }
+                carryLength += count;
+                break;
+            }
+            if (carryLength > 0) {
+                size_t count = lineEnd - cursor;
+                if (carryLength <= MAX_LEXED_COLUMNS) {
+                    carry.append(cursor, min(count, MAX_LEXED_COLUMNS + 1 - carry.size()));
+                }
+                carryLength += count;
+                state = lexLine(language, carry.data(), carryLength > MAX_LEXED_COLUMNS ? carryLength : carry.size(), state, nullptr);
+                carry.clear();
+                carryLength = 0;
+            } else {
+                state = lexLine(language, cursor, lineEnd - cursor, state, nullptr);  // Lexed in place
+            }
+            passStates.push_back(state);
+            cursor = lineEnd + 1;
+        }
+        offset += span.second;
+    }
+    // The last line has no '\n' (and may be empty)
+    passStates.push_back(lexLine(language, carry.data(), carryLength > MAX_LEXED_COLUMNS ? carryLength : carry.size(), state, nullptr));
+    finished.store(true);
+}
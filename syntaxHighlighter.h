@@ -0,0 +1,145 @@
+#ifndef SYNTAXHIGHLIGHTER_H
+#define SYNTAXHIGHLIGHTER_H
+
+#include <string>
+#include <vector>   // For the tokens of a line and the blocks of states
+#include <map>      // For the ranges of lines to lex again
+#include <cstddef>  // For size_t
+#include <cstdint>  // For the one byte lexer states
+#include <atomic>   // For the flags shared with the lexing thread
+#include <thread>   // For the first pass in the background
+#include "pieceTable.h" // For the document and the snapshot the first pass reads
+
+// LineStates class to keep one lexer state per line of the document
+// The states are stored in blocks of a few thousand lines, with the first line of every block, so
+// adding or removing lines moves the states of one block instead of every state after the edit.
+class LineStates {
+public:
+    // Constructor to create an empty list
+    LineStates();
+
+    // Method to get the number of lines
+    size_t size() const;
+    // Methods to read and write the state of a line
+    uint8_t get(size_t line) const;
+    void set(size_t line, uint8_t state);
+    // Method to insert count lines with the same state before a line
+    void insert(size_t line, size_t count, uint8_t state);
+    // Method to remove count lines starting at a line
+    void erase(size_t line, size_t count);
+    // Method to replace every state from a line on with a list of states
+    void replaceFrom(size_t line, const std::vector<uint8_t>& newStates);
+    // Method to remove every line
+    void clear();
+
+private:
+    std::vector<std::vector<uint8_t>> blocks; // States of consecutive lines, never empty
+    std::vector<size_t> starts;               // First line of every block
+    size_t total;                             // Number of lines
+
+    // Helper to find the block that holds a line
+    size_t locate(size_t line) const;
+    // Helper to cut the blocks that grew too big and compute the first lines again from a block on
+    void renumber(size_t fromBlock);
+};
+
+// SyntaxHighlighter class to color source and configuration files
+// The lexer works one line at a time and carries a small state from one line to the next (inside a
+// block comment or a multi-line string), and the state at the end of every line is cached. After an
+// edit only the edited lines are lexed again, followed by the next lines until a line ends in the
+// state it ended in before: typing in a line usually lexes that single line, whatever the file size.
+// The first pass over a file, and an edit that changes the state of many lines (opening a block
+// comment at the top of a large file), are lexed by a worker thread from a snapshot of the document;
+// the edits made in the meantime are applied to its result when it is merged.
+// Lines longer than MAX_LEXED_COLUMNS are not lexed: they are drawn plain and keep the state they start in.
+class SyntaxHighlighter {
+public:
+    // Kind enum to describe what a token is, so the editor can pick its color
+    enum Kind : uint8_t { KEYWORD, STRING, COMMENT, NUMBER, DIRECTIVE };
+
+    // Token struct to describe one colored run of a line (the text between tokens is plain)
+    struct Token {
+        size_t start;   // Column of the first character
+        size_t length;  // Number of characters
+        Kind kind;      // What the characters are
+    };
+
+    // Constructor to create a highlighter that colors nothing
+    SyntaxHighlighter();
+    // Destructor to stop the lexing thread
+    ~SyntaxHighlighter();
+
+    // The lexing thread works on this object, so it cannot be copied
+    SyntaxHighlighter(const SyntaxHighlighter&) = delete;
+    SyntaxHighlighter& operator=(const SyntaxHighlighter&) = delete;
+
+    // Method to choose the language from the name of the opened file and forget every state
+    // Files of an unknown kind (.txt included) are not highlighted and cost nothing.
+    void setLanguage(const std::string& filename);
+    // Method to know whether the document is highlighted
+    bool isActive() const;
+    // Method to tell the highlighter about an edit: a line was changed, removedLines lines after it were
+    // removed and addedLines new lines follow it
+    void onEdit(size_t line, size_t removedLines, size_t addedLines);
+    // Method to bring the states up to date (call it once per frame, once the file is fully open)
+    // It starts and merges the passes of the worker and lexes the edited lines again; it returns true
+    // when the colors of some lines may have changed.
+    bool update(const PieceTable& document);
+    // Method to know whether update() still has work to do
+    bool isBusy() const;
+    // Method to know whether the next update() can do some of it (false while a pass runs on the worker)
+    bool hasWorkReady() const;
+    // Method to get the state a line starts in (the approximate one while the worker has not finished)
+    uint8_t stateBefore(size_t line) const;
+    // Method to lex a line from a state into tokens, returns the state at its end
+    uint8_t lineTokens(const PieceTable& document, size_t line, uint8_t state, std::vector<Token>& tokens) const;
+
+    static const size_t MAX_LEXED_COLUMNS = 20000; // Longer lines are not lexed
+
+private:
+    // Language enum to choose the rules of the lexer
+    enum Language { NONE, C_FAMILY, SCRIPT };
+
+    // LineEdit struct to remember an edit made while the worker lexes an older version of the document
+    struct LineEdit {
+        size_t line;     // Line that was changed
+        size_t removed;  // Lines removed after it
+        size_t added;    // Lines added after it
+    };
+
+    Language language;              // Rules of the lexer (NONE: nothing is highlighted)
+    LineStates states;              // State at the end of every line, once a pass has been merged
+    bool known;                     // True when states has one entry per line of the document
+    bool fullPassPending;           // True until the first pass is started (it waits for the file to be open)
+    std::map<size_t, size_t> dirty; // Ranges of lines to lex again: first line to last line (included)
+
+    TextSnapshot text;              // Version of the document the worker lexes
+    size_t passLine;                // First line the worker lexes
+    size_t passOffset;              // Document offset of that line
+    uint8_t passState;              // State that line starts in
+    std::vector<uint8_t> passStates; // State at the end of every line lexed by the worker
+    std::vector<LineEdit> passEdits; // Edits made since the snapshot was taken
+    std::thread worker;             // Thread lexing the snapshot
+    std::atomic<bool> stopRequested; // Set to ask the worker to stop
+    std::atomic<bool> finished;     // Set by the worker when passStates is complete
+
+    // Helper to lex one line of text; tokens may be nullptr when only the end state is needed
+    static uint8_t lexLine(Language language, const char* text, size_t length, uint8_t state, std::vector<Token>* tokens);
+    // Helper to lex one line of the document and return its end state
+    uint8_t lexDocumentLine(const PieceTable& document, size_t line, uint8_t state) const;
+    // Helper to apply an edit to the states and mark the lines to lex again
+    void applyEdit(const LineEdit& edit);
+    // Helper to lex the dirty lines until their states converge, at most budget lines; returns the number of lines lexed
+    size_t relex(const PieceTable& document, size_t budget);
+    // Helpers to start the worker on every line from a line on, and to stop it
+    void startPass(const PieceTable& document, size_t line, uint8_t state);
+    void stopPass();
+    // Helper to take the result of the worker and apply the edits made meanwhile
+    void mergePass();
+    // Helper run by the worker to lex every line of the snapshot
+    void lexSnapshot();
+    // Helper to know whether the worker is running
+    bool isPassRunning() const;
+};
+
+#endif // SYNTAXHIGHLIGHTER_H
@@ -0,0 +1,282 @@
+#include    "textRenderer.h" // Include the header file for the batched text renderer
+#include    <algorithm>      // For upper_bound
+using namespace std; // Use the standard namespace for convenience
+
+// Constructor to create a renderer without a font
+// Until a font is loaded every glyph advances by one unit and there is no kerning.
+TextRenderer::TextRenderer() : characterSize(0), narrowestAdvance(1.f), digitAdvance(1.f), textX(MIN_TEXT_X), kerning(GLYPH_COUNT * GLYPH_COUNT, 0.f), vertices(sf::Triangles), dirty(true), rebuiltLines(0) {
+    for (GlyphInfo& glyph : glyphs) {
+        glyph.advance = 1.f;
+    }
+}
+
+// Function to load the font and build the glyph atlas
+bool TextRenderer::loadFromFile(const string& filename, unsigned size) {
+    if (!font.loadFromFile(filename)) {
+        return false;
+    }
+    characterSize = size;
+
+    // Asking the font for a glyph rasterizes it into the font texture, so after this loop
+    // every printable character is in the atlas and the texture never has to grow again
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        const sf::Glyph& glyph = font.getGlyph(FIRST_GLYPH + i, characterSize, false);
+        glyphs[i].bounds = glyph.bounds;
+        glyphs[i].textureRect = sf::FloatRect(static_cast<float>(glyph.textureRect.left), static_cast<float>(glyph.textureRect.top),
+                                              static_cast<float>(glyph.textureRect.width), static_cast<float>(glyph.textureRect.height));
+        glyphs[i].advance = glyph.advance;
+    }
+    narrowestAdvance = 0.f;
+    for (const GlyphInfo& glyph : glyphs) {
+        if (glyph.advance > 0.f && (narrowestAdvance == 0.f || glyph.advance < narrowestAdvance)) {
+            narrowestAdvance = glyph.advance;
+        }
+    }
+    if (narrowestAdvance == 0.f) {
+        narrowestAdvance = 1.f;  // A font without advances would show nothing anyway
+    }
+    digitAdvance = 0.f;
+    for (char digit = '0'; digit <= '9'; digit++) {
+        digitAdvance = max(digitAdvance, glyphs[digit - FIRST_GLYPH].advance);
+    }
+
+    // Cache the kerning of every pair so building a line never has to ask the font again
+    kerning.assign(GLYPH_COUNT * GLYPH_COUNT, 0.f);
+    for (int first = 0; first < GLYPH_COUNT; first++) {
+        for (int second = 0; second < GLYPH_COUNT; second++) {
+            kerning[first * GLYPH_COUNT + second] = font.getKerning(FIRST_GLYPH + first, FIRST_GLYPH + second, characterSize);
+        }
+    }
+
+    // Quads and positions measured with another font are no longer valid
+    previousLines.clear();
+    measuredLines.clear();
+    dirty = true;
+    return true;
+}
+
+// Function to get the loaded font
+const sf::Font& TextRenderer::getFont() const {
+    return font;
+}
+
+// Function to get the x position of every column of a line, measuring it when it is not cached
+const vector<float>& TextRenderer::lineAdvances(size_t lineIndex, const string& text) {
+    auto found = measuredLines.find(lineIndex);
+    // The size check catches a line that changed without being invalidated
+    if (found != measuredLines.end() && found->second.size() == text.size() + 1) {
+        return found->second;
+    }
+    if (found == measuredLines.end() && measuredLines.size() >= MAX_MEASURED_LINES) {
+        measuredLines.clear();  // Scrolled far away; the lines shown next are measured again
+    }
+    vector<float>& advances = measuredLines[lineIndex];
+
+    // Each column adds the advance of its character and the kerning with the character before it
+    advances.resize(text.size() + 1);
+    float x = 0.f;
+    int previous = -1;
+    advances[0] = 0.f;
+    for (size_t i = 0; i < text.size(); i++) {
+        int index = glyphIndex(text[i]);
+        if (previous >= 0) {
+            x += kerning[previous * GLYPH_COUNT + index];
+        }
+        x += glyphs[index].advance;
+        previous = index;
+        advances[i + 1] = x;
+    }
+    return advances;
+}
+
+// Function to get the cached x positions of a line
+const vector<float>* TextRenderer::cachedAdvances(size_t lineIndex) const {
+    auto found = measuredLines.find(lineIndex);
+    return found != measuredLines.end() ? &found->second : nullptr;
+}
+
+// Function to forget the x positions of one line
+void TextRenderer::invalidateLine(size_t lineIndex) {
+    measuredLines.erase(lineIndex);
+}
+
+// Function to forget the x positions of a line and of every line after it
+void TextRenderer::invalidateLinesFrom(size_t lineIndex) {
+    measuredLines.erase(measuredLines.lower_bound(lineIndex), measuredLines.end());
+}
+
+// Function to find the column closest to an x position
+size_t TextRenderer::xToColumn(const vector<float>& advances, float x) {
+    // First column that starts after x; the one before it starts at or before x
+    size_t after = upper_bound(advances.begin(), advances.end(), x) - advances.begin();
+    if (after == 0) {
+        return 0;
+    }
+    if (after == advances.size()) {
+        return advances.size() - 1;  // Past the end of the line
+    }
+    // Round to the nearer edge of the character under x
+    return x - advances[after - 1] <= advances[after] - x ? after - 1 : after;
+}
+
+// Function to get how many columns of any text can be visible in a width
+size_t TextRenderer::columnsFitting(float width) const {
+    // Kerning can pull characters a little closer, the extra columns cover it
+    return width > 0.f ? static_cast<size_t>(width / narrowestAdvance) + 2 : 1;
+}
+
+// Function to get how many characters at the end of a text fit in a width
+size_t TextRenderer::columnsBefore(const string& text, float width) const {
+    size_t count = 0;
+    for (size_t i = text.size(); i > 0; i--) {
+        width -= glyphs[glyphIndex(text[i - 1])].advance;
+        if (width < 0.f) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Function to start a new frame
+void TextRenderer::beginFrame() {
+    currentLines.clear();
+    lineOffsets.clear();
+    rebuiltLines = 0;
+}
+
+// Function to add a visible line to the frame
+void TextRenderer::addLine(size_t lineIndex, const string& text, float y, float maxWidth, const vector<ColorRun>& runs) {
+    // Reuse the quads of the previous frame when the same line is shown with the same text and colors
+    for (size_t k = 0; k < previousLines.size(); k++) {
+        CachedLine& cached = previousLines[k];
+        if (cached.lineIndex == lineIndex && cached.maxWidth == maxWidth && cached.text == text && cached.runs == runs) {
+            // A reused line that moved to another row still needs the frame to be assembled again
+            if (k != currentLines.size()) {
+                dirty = true;
+            }
+            currentLines.push_back(std::move(cached));
+            cached.lineIndex = static_cast<size_t>(-1);  // The moved-from entry must not match again
+            lineOffsets.push_back(y);
+            return;
+        }
+    }
+
+    // Otherwise build the quads of the line number and of the text again
+    CachedLine line;
+    line.lineIndex = lineIndex;
+    line.text = text;
+    line.maxWidth = maxWidth;
+    line.runs = runs;
+    appendText(line.vertices, to_string(lineIndex + 1), NUMBER_X, sf::Color::Blue, textX);
+    appendText(line.vertices, text, textX, sf::Color::Black, maxWidth, runs);
+    currentLines.push_back(std::move(line));
+    lineOffsets.push_back(y);
+    rebuiltLines++;
+    dirty = true;
+}
+
+// Function to draw the whole frame with one draw call
+void TextRenderer::draw(sf::RenderTarget& target) {
+    // The frame only has to be assembled again when a line changed, moved or disappeared
+    if (currentLines.size() != previousLines.size()) {
+        dirty = true;
+    }
+
+    if (dirty) {
+        vertices.clear();
+        for (size_t i = 0; i < currentLines.size(); i++) {
+            // The cached quads start at y = 0, so only the row offset has to be added
+            for (const sf::Vertex& vertex : currentLines[i].vertices) {
+                sf::Vertex moved = vertex;
+                moved.position.y += lineOffsets[i];
+                vertices.append(moved);
+            }
+        }
+        dirty = false;
+    }
+
+    target.draw(vertices, sf::RenderStates(&font.getTexture(characterSize)));
+
+    // The lines of this frame are the cache of the next one
+    previousLines.swap(currentLines);
+}
+
+// Function to get how many lines had to be rebuilt in the last frame
+size_t TextRenderer::getRebuiltLines() const {
+    return rebuiltLines;
+}
+
+// Function to widen or narrow the line number gutter for the number of lines of the document
+// MIN_TEXT_X fits three digits; every digit past the third moves the text right by the widest digit.
+void TextRenderer::setLineCount(size_t lineCount) {
+    size_t digits = to_string(lineCount).size();
+    float x = MIN_TEXT_X + (digits > 3 ? (digits - 3) * digitAdvance : 0.f);
+    if (x != textX) {
+        textX = x;
+        previousLines.clear();  // Every cached line starts its text at the old position
+        dirty = true;
+    }
+}
+
+// Function to get the horizontal position of the text
+float TextRenderer::getTextX() const {
+    return textX;
+}
+
+// Function to map a character to its atlas slot
+int TextRenderer::glyphIndex(char c) {
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+        c = '?';  // Tabs, control and non ASCII bytes have no glyph in the atlas
+    }
+    return c - FIRST_GLYPH;
+}
+
+// Function to append two triangles for every visible glyph of a string
+void TextRenderer::appendText(vector<sf::Vertex>& out, const string& text, float x, sf::Color color, float maxWidth,
+                              const vector<ColorRun>& runs) const {
+    const float padding = 1.f;  // Same padding as sf::Text so the glyph edges are not cut
+    float baseline = static_cast<float>(characterSize);  // sf::Text puts the baseline one character size below the top
+    int previous = -1;
+    size_t run = 0;  // First run that does not end before the current character
+
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        int index = glyphIndex(c);
+        while (run < runs.size() && runs[run].start + runs[run].length <= i) {
+            run++;
+        }
+        sf::Color glyphColor = run < runs.size() && runs[run].start <= i ? runs[run].color : color;
+        if (previous >= 0) {
+            x += kerning[previous * GLYPH_COUNT + index];
+        }
+        previous = index;
+        const GlyphInfo& glyph = glyphs[index];
+
+        // Stop as soon as the glyphs leave the window
+        if (x + glyph.bounds.left > maxWidth) {
+            break;
+        }
+
+        // Spaces have no pixels, so they only move the pen
+        if (glyph.bounds.width > 0.f) {
+            float left = x + glyph.bounds.left - padding;
+            float top = baseline + glyph.bounds.top - padding;
+            float right = x + glyph.bounds.left + glyph.bounds.width + padding;
+            float bottom = baseline + glyph.bounds.top + glyph.bounds.height + padding;
+
+            float u1 = glyph.textureRect.left - padding;
+            float v1 = glyph.textureRect.top - padding;
+            float u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+            float v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+
+            out.push_back(sf::Vertex(sf::Vector2f(left, top), glyphColor, sf::Vector2f(u1, v1)));
+            out.push_back(sf::Vertex(sf::Vector2f(right, top), glyphColor, sf::Vector2f(u2, v1)));
+            out.push_back(sf::Vertex(sf::Vector2f(left, bottom), glyphColor, sf::Vector2f(u1, v2)));
+            out.push_back(sf::Vertex(sf::Vector2f(left, bottom), glyphColor, sf::Vector2f(u1, v2)));
+            out.push_back(sf::Vertex(sf::Vector2f(right, top), glyphColor, sf::Vector2f(u2, v1)));
+            out.push_back(sf::Vertex(sf::Vector2f(right, bottom), glyphColor, sf::Vector2f(u2, v2)));
+        }
+        x += glyph.advance;
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <SFML/Graphics.hpp>  // Include for the font, its glyph texture and vertex arrays
+#include <string>
+#include <vector>
+#include <map>     // For the measured lines, ordered so the lines after an edit can be dropped at once
+
+// GlyphInfo struct to store the metrics of one character of the atlas
+struct GlyphInfo {
+    sf::FloatRect bounds;       // Quad of the glyph relative to the pen position on the baseline
+    sf::FloatRect textureRect;  // Where the glyph is inside the font texture
+    float advance;              // Horizontal distance to the next pen position
+};
+
+// ColorRun struct to draw part of a line in another color than the text color
+struct ColorRun {
+    size_t start;     // First character of the run, counted from the start of the drawn text
+    size_t length;    // Number of characters
+    sf::Color color;  // Color of these characters
+
+    bool operator==(const ColorRun& other) const {
+        return start == other.start && length == other.length && color == other.color;
+    }
+};
+
+// CachedLine struct to keep the quads of one visible line between frames
+// The quads are built with the top of the line at y = 0 so they stay valid when the line scrolls.
+struct CachedLine {
+    size_t lineIndex;                 // Line of the document the quads belong to
+    std::string text;                 // Content the quads were built from
+    float maxWidth;                   // Right edge used for clipping when the quads were built
+    std::vector<ColorRun> runs;       // Colors the quads were built with (syntax highlighting)
+    std::vector<sf::Vertex> vertices; // Two triangles per glyph, line number included
+};
+
+// TextRenderer class to draw the visible lines in a single draw call
+// Every printable ASCII glyph is rasterized once into the font texture (the glyph atlas) and its
+// metrics and kerning are cached in tables. Each frame the visible lines are emitted as textured
+// quads into one reusable sf::VertexArray; the quads of a line are rebuilt only when it changed.
+// The x position of every column of a line is measured once into a table of prefix sums, kept until
+// the editor reports that the line changed, so placing the cursor or a highlight is a lookup and
+// mapping an x position back to a column is a binary search.
+// Without a font every character is one unit wide, so x positions are column numbers.
+class TextRenderer {
+public:
+    // Constructor to create a renderer without a font
+    TextRenderer();
+
+    // Method to load the font and build the glyph atlas for one character size
+    bool loadFromFile(const std::string& filename, unsigned size);
+    // Method to get the loaded font (for the widgets still drawn with sf::Text)
+    const sf::Font& getFont() const;
+    // Method to get the x position of every column of a line: entry i is the left edge of column i and the
+    // last entry is the end of the line. The line is measured the first time and then read from the cache.
+    const std::vector<float>& lineAdvances(size_t lineIndex, const std::string& text);
+    // Method to get the cached x positions of a line, or nullptr when it has not been measured
+    const std::vector<float>* cachedAdvances(size_t lineIndex) const;
+    // Methods to forget the measured x positions of an edited line, or of every line from it on when lines
+    // were added or removed (the lines after it have moved)
+    void invalidateLine(size_t lineIndex);
+    void invalidateLinesFrom(size_t lineIndex);
+    // Method to find the column whose left edge is closest to an x position
+    static size_t xToColumn(const std::vector<float>& advances, float x);
+    // Method to get how many columns of any text can be visible in a width (used to cut long lines)
+    size_t columnsFitting(float width) const;
+    // Method to get how many characters at the end of a text fit in a width
+    size_t columnsBefore(const std::string& text, float width) const;
+
+    // Method to start a new frame
+    void beginFrame();
+    // Method to add a visible line, y being the top of the line in window coordinates
+    // The runs, sorted and not overlapping, color parts of the text; the rest is drawn in black.
+    void addLine(size_t lineIndex, const std::string& text, float y, float maxWidth, const std::vector<ColorRun>& runs = {});
+    // Method to draw every line added since beginFrame with one draw call
+    void draw(sf::RenderTarget& target);
+    // Method to get how many lines had to be rebuilt in the last frame
+    size_t getRebuiltLines() const;
+    // Method to widen or narrow the line number gutter for the number of lines of the document
+    void setLineCount(size_t lineCount);
+    // Method to get the horizontal position of the text, right of the gutter
+    float getTextX() const;
+
+    // Horizontal position of the line numbers, and of the text while the numbers have three digits or fewer
+    static constexpr float NUMBER_X = 10.f;
+    static constexpr float MIN_TEXT_X = 50.f;
+
+private:
+    static constexpr char FIRST_GLYPH = 32;   // ' '
+    static constexpr char LAST_GLYPH = 126;   // '~'
+    static constexpr int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+    static constexpr size_t MAX_MEASURED_LINES = 4096;  // The measured lines are all dropped past this many
+
+    sf::Font font;                         // Font that owns the glyph texture
+    unsigned characterSize;                // Size the atlas was built for
+    GlyphInfo glyphs[GLYPH_COUNT];         // Metrics of every printable character
+    float narrowestAdvance;                // Smallest advance of a printable character
+    float digitAdvance;                    // Largest advance of a digit, to size the gutter
+    float textX;                           // Horizontal position of the text (the gutter grows with the line numbers)
+    std::vector<float> kerning;            // Kerning of every pair of printable characters
+    std::vector<CachedLine> previousLines; // Lines drawn in the previous frame
+    std::vector<CachedLine> currentLines;  // Lines added in the current frame
+    std::vector<float> lineOffsets;        // Top of every line of the current frame
+    std::map<size_t, std::vector<float>> measuredLines; // x position of every column of the measured lines
+    sf::VertexArray vertices;              // Reusable vertex array holding the whole frame
+    bool dirty;                            // True when the vertex array must be assembled again
+    size_t rebuiltLines;                   // Number of lines rebuilt in the current frame
+
+    // Helper to map any character to an atlas slot (unknown characters are drawn as '?')
+    static int glyphIndex(char c);
+    // Helper to append the quads of a string starting at a pen position
+    void appendText(std::vector<sf::Vertex>& out, const std::string& text, float x, sf::Color color, float maxWidth,
+                    const std::vector<ColorRun>& runs = {}) const;
+};
+
+#endif // TEXTRENDERER_H
@@ -0,0 +1,387 @@
+#include    "textScan.h" // Include the header file for the scanning kernels
+#include    <algorithm>  // For min
+#include    <atomic>     // For the selected implementation
+#include    <cstring>    // For memchr and memcmp
+using namespace std; // Use the standard namespace for convenience
+
+// The vector kernels only exist on x86 processors, everything else uses the scalar versions
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXTSCAN_X86
+#include    <immintrin.h> // For the SSE2 and AVX2 intrinsics
+#ifdef _MSC_VER
+#include    <intrin.h>    // For __cpuid and _BitScanForward
+#endif
+#endif
+
+// GCC and Clang compile each kernel for its own instruction set, so the rest of the program needs no -mavx2
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// Helper to get the index of the lowest set bit of a non zero mask
+static inline unsigned trailingZeros(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (static_cast<uint32_t>(mask)) {
+        _BitScanForward(&index, static_cast<uint32_t>(mask));
+        return index;
+    }
+    _BitScanForward(&index, static_cast<uint32_t>(mask >> 32));
+    return index + 32;
+#else
+    unsigned index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Helper to count the set bits of a mask
+static inline unsigned setBits(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(mask));
+#else
+    unsigned count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Helper to store the positions of the set bits of a 64 byte block mask
+// The first four are written unconditionally so a typical block (one line feed every 60 bytes) needs no
+// unpredictable branch; out must have room for four more positions than there are matches.
+template <typename T>
+static inline T* storeBits(T* out, uint64_t mask, T position) {
+    const uint64_t guard = 1ull << 63;  // Keeps the bit scan defined once the mask is empty, the value is then overwritten
+    unsigned matches = setBits(mask);
+    for (int k = 0; k < 4; k++) {
+        out[k] = position + static_cast<T>(trailingZeros(mask | guard));
+        mask &= mask - 1;
+    }
+    if (matches <= 4) {
+        return out + matches;
+    }
+    out += 4;
+    for (; mask; mask &= mask - 1) {
+        *out++ = position + static_cast<T>(trailingZeros(mask));
+    }
+    return out;
+}
+
+// Helper to make room for at least extra + 68 positions after the first used ones, returns where to write next
+template <typename T>
+static inline T* reserveOutput(std::vector<T>& positions, size_t used, size_t extra) {
+    size_t needed = used + extra + 64 + 4;
+    if (positions.size() < needed) {
+        positions.resize(needed);  // The capacity still grows geometrically
+    }
+    return positions.data() + used;
+}
+
+// Helper to find the best implementation the processor supports
+static TextScan::Implementation detect() {
+#if defined(TEXTSCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return TextScan::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return TextScan::SSE2;
+    }
+#elif defined(TEXTSCAN_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int highest = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;  // The OS saves the AVX registers
+    if (highest >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return TextScan::AVX2;
+        }
+    }
+    if (sse2) {
+        return TextScan::SSE2;
+    }
+#endif
+    return TextScan::SCALAR;
+}
+
+// Helper to get the implementation in use, detected on first use
+static atomic<int>& selected() {
+    static atomic<int> implementation(detect());
+    return implementation;
+}
+
+// Scalar kernels: memchr skips over the text between the matches
+
+static size_t countScalar(const char* data, size_t size, char byte) {
+    size_t total = 0;
+    const char* end = data + size;
+    while (data < end && (data = static_cast<const char*>(memchr(data, byte, end - data)))) {
+        total++;
+        data++;
+    }
+    return total;
+}
+
+template <typename T>
+static void findAllScalar(const char* data, size_t size, char byte, T base, vector<T>& positions) {
+    const char* cursor = data;
+    const char* end = data + size;
+    while (cursor < end && (cursor = static_cast<const char*>(memchr(cursor, byte, end - cursor)))) {
+        positions.push_back(base + static_cast<T>(cursor - data));
+        cursor++;
+    }
+}
+
+static const char* findScalar(const char* data, size_t size, const char* pattern, size_t patternSize) {
+    if (patternSize == 0) {
+        return data;
+    }
+    if (patternSize > size) {
+        return nullptr;
+    }
+    const char* last = data + size - patternSize;  // Last position where the pattern still fits
+    for (const char* cursor = data; cursor <= last; cursor++) {
+        cursor = static_cast<const char*>(memchr(cursor, pattern[0], last - cursor + 1));
+        if (!cursor) {
+            return nullptr;
+        }
+        if (memcmp(cursor + 1, pattern + 1, patternSize - 1) == 0) {
+            return cursor;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef TEXTSCAN_X86
+
+// SSE2 kernels: 16 bytes per comparison
+
+TARGET_SSE2 static size_t countSse2(const char* data, size_t size, char byte) {
+    const __m128i needle = _mm_set1_epi8(byte);
+    const __m128i zero = _mm_setzero_si128();
+    size_t total = 0;
+    size_t i = 0;
+    while (size - i >= 16) {
+        // Every byte lane counts its matches (a match compares to -1); a lane holds at most 255 of them
+        size_t blocks = min((size - i) / 16, static_cast<size_t>(255));
+        __m128i counts = zero;
+        for (size_t block = 0; block < blocks; block++, i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(chunk, needle));
+        }
+        // Sum the lanes into two 64 bit halves
+        __m128i sums = _mm_sad_epu8(counts, zero);
+        total += static_cast<size_t>(_mm_cvtsi128_si32(sums)) + static_cast<size_t>(_mm_extract_epi16(sums, 4));
+    }
+    return total + countScalar(data + i, size - i, byte);
+}
+
+template <typename T>
+TARGET_SSE2 static void findAllSse2(const char* data, size_t size, char byte, T base, vector<T>& positions) {
+    if (size < 64) {
+        findAllScalar(data, size, byte, base, positions);  // Typed text is usually a few characters
+        return;
+    }
+    // The output grows in large steps and is checked once per 64 byte block, not once per match
+    T* out = reserveOutput(positions, positions.size(), size / 32);
+    const __m128i needle = _mm_set1_epi8(byte);
+    size_t i = 0;
+    // 64 bytes per step, so the text between two line feeds is skipped with one test
+    for (; i + 64 <= size; i += 64) {
+        const __m128i* block = reinterpret_cast<const __m128i*>(data + i);
+        uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block), needle)))
+                      | static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 1), needle))) << 16
+                      | static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 2), needle))) << 32
+                      | static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(block + 3), needle))) << 48;
+        if (static_cast<size_t>(positions.data() + positions.size() - out) < 64 + 4) {
+            out = reserveOutput(positions, out - positions.data(), (size - i) / 32);
+        }
+        out = storeBits(out, mask, base + static_cast<T>(i));
+    }
+    out = reserveOutput(positions, out - positions.data(), size - i);
+    for (; i < size; i++) {
+        if (data[i] == byte) {
+            *out++ = base + static_cast<T>(i);
+        }
+    }
+    positions.resize(out - positions.data());  // Drop the room that was not used
+}
+
+TARGET_SSE2 static const char* findSse2(const char* data, size_t size, const char* pattern, size_t patternSize) {
+    if (patternSize < 2 || patternSize > size) {
+        return findScalar(data, size, pattern, patternSize);
+    }
+    // A candidate must match the first and the last byte of the pattern; only those are compared in full
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i last = _mm_set1_epi8(pattern[patternSize - 1]);
+    size_t i = 0;
+    for (; i + patternSize - 1 + 16 <= size; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + patternSize - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+        while (mask) {
+            size_t candidate = i + trailingZeros(mask);
+            if (memcmp(data + candidate + 1, pattern + 1, patternSize - 2) == 0) {
+                return data + candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(data + i, size - i, pattern, patternSize);
+}
+
+// AVX2 kernels: 32 bytes per comparison
+
+TARGET_AVX2 static size_t countAvx2(const char* data, size_t size, char byte) {
+    const __m256i needle = _mm256_set1_epi8(byte);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t total = 0;
+    size_t i = 0;
+    while (size - i >= 32) {
+        size_t blocks = min((size - i) / 32, static_cast<size_t>(255));
+        __m256i counts = zero;
+        for (size_t block = 0; block < blocks; block++, i += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(chunk, needle));
+        }
+        __m256i sums = _mm256_sad_epu8(counts, zero);
+        __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        total += static_cast<size_t>(_mm_cvtsi128_si32(halves)) + static_cast<size_t>(_mm_extract_epi16(halves, 4));
+    }
+    return total + countScalar(data + i, size - i, byte);
+}
+
+template <typename T>
+TARGET_AVX2 static void findAllAvx2(const char* data, size_t size, char byte, T base, vector<T>& positions) {
+    if (size < 64) {
+        findAllScalar(data, size, byte, base, positions);  // Typed text is usually a few characters
+        return;
+    }
+    // The output grows in large steps and is checked once per 64 byte block, not once per match
+    T* out = reserveOutput(positions, positions.size(), size / 32);
+    const __m256i needle = _mm256_set1_epi8(byte);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const __m256i* block = reinterpret_cast<const __m256i*>(data + i);
+        uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(block), needle)))
+                      | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(block + 1), needle)))) << 32;
+        if (static_cast<size_t>(positions.data() + positions.size() - out) < 64 + 4) {
+            out = reserveOutput(positions, out - positions.data(), (size - i) / 32);
+        }
+        out = storeBits(out, mask, base + static_cast<T>(i));
+    }
+    out = reserveOutput(positions, out - positions.data(), size - i);
+    for (; i < size; i++) {
+        if (data[i] == byte) {
+            *out++ = base + static_cast<T>(i);
+        }
+    }
+    positions.resize(out - positions.data());  // Drop the room that was not used
+}
+
+TARGET_AVX2 static const char* findAvx2(const char* data, size_t size, const char* pattern, size_t patternSize) {
+    if (patternSize < 2 || patternSize > size) {
+        return findScalar(data, size, pattern, patternSize);
+    }
+    const __m256i first = _mm256_set1_epi8(pattern[0]);
+    const __m256i last = _mm256_set1_epi8(pattern[patternSize - 1]);
+    size_t i = 0;
+    for (; i + patternSize - 1 + 32 <= size; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + patternSize - 1));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+        while (mask) {
+            size_t candidate = i + trailingZeros(mask);
+            if (memcmp(data + candidate + 1, pattern + 1, patternSize - 2) == 0) {
+                return data + candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(data + i, size - i, pattern, patternSize);
+}
+
+#endif // TEXTSCAN_X86
+
+// Helper to run the findAll kernel of the selected implementation
+template <typename T>
+static void findAllWith(const char* data, size_t size, char byte, T base, vector<T>& positions) {
+#ifdef TEXTSCAN_X86
+    switch (selected().load(memory_order_relaxed)) {
+        case TextScan::AVX2: findAllAvx2(data, size, byte, base, positions); return;
+        case TextScan::SSE2: findAllSse2(data, size, byte, base, positions); return;
+        default: break;
+    }
+#endif
+    findAllScalar(data, size, byte, base, positions);
+}
+
+// Function to count the bytes of a buffer equal to byte
+size_t TextScan::count(const char* data, size_t size, char byte) {
+#ifdef TEXTSCAN_X86
+    switch (selected().load(memory_order_relaxed)) {
+        case AVX2: return countAvx2(data, size, byte);
+        case SSE2: return countSse2(data, size, byte);
+        default: break;
+    }
+#endif
+    return countScalar(data, size, byte);
+}
+
+// Functions to find the position of every byte of a buffer equal to byte
+void TextScan::findAll(const char* data, size_t size, char byte, uint32_t base, vector<uint32_t>& positions) {
+    findAllWith(data, size, byte, base, positions);
+}
+
+void TextScan::findAll(const char* data, size_t size, char byte, size_t base, vector<size_t>& positions) {
+    findAllWith(data, size, byte, base, positions);
+}
+
+// Function to find the first occurrence of a pattern in a buffer
+const char* TextScan::find(const char* data, size_t size, const char* pattern, size_t patternSize) {
+#ifdef TEXTSCAN_X86
+    switch (selected().load(memory_order_relaxed)) {
+        case AVX2: return findAvx2(data, size, pattern, patternSize);
+        case SSE2: return findSse2(data, size, pattern, patternSize);
+        default: break;
+    }
+#endif
+    return findScalar(data, size, pattern, patternSize);
+}
+
+// Function to get the implementation in use
+TextScan::Implementation TextScan::implementation() {
+    return static_cast<Implementation>(selected().load(memory_order_relaxed));
+}
+
+// Function to get the name of an implementation
+const char* TextScan::name(Implementation implementation) {
+    switch (implementation) {
+        case AVX2: return "avx2";
+        case SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+// Function to force an implementation; only the ones up to the detected one can be used
+bool TextScan::select(Implementation implementation) {
+    if (implementation > detect()) {
+        return false;
+    }
+    selected().store(implementation, memory_order_relaxed);
+    return true;
+}
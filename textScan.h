@@ -0,0 +1,32 @@
+#ifndef TEXTSCAN_H
+#define TEXTSCAN_H
+
+#include <vector>   // For the found positions
+#include <cstdint>  // For uint32_t positions
+#include <cstddef>  // For size_t
+
+// TextScan class with the vectorized kernels used to scan text
+// Every kernel has an AVX2, an SSE2 and a scalar version; the fastest one the processor supports is
+// selected the first time a kernel runs. They compare 16 or 32 bytes per instruction, so counting and
+// finding line feeds runs at memory bandwidth instead of testing one character at a time.
+class TextScan {
+public:
+    enum Implementation { SCALAR, SSE2, AVX2 };
+
+    // Method to count the bytes of a buffer equal to byte
+    static size_t count(const char* data, size_t size, char byte);
+    // Methods to append base + the position of every byte of a buffer equal to byte
+    static void findAll(const char* data, size_t size, char byte, uint32_t base, std::vector<uint32_t>& positions);
+    static void findAll(const char* data, size_t size, char byte, size_t base, std::vector<size_t>& positions);
+    // Method to find the first occurrence of a pattern in a buffer (nullptr when there is none)
+    static const char* find(const char* data, size_t size, const char* pattern, size_t patternSize);
+
+    // Method to get the implementation in use
+    static Implementation implementation();
+    // Method to get the name of an implementation
+    static const char* name(Implementation implementation);
+    // Method to force an implementation (used by the benchmark), false when the processor does not support it
+    static bool select(Implementation implementation);
+};
+
+#endif // TEXTSCAN_H
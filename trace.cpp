@@ -0,0 +1,132 @@
+#include    "trace.h"   // Include the header file for the trace ring buffer
+#include    <chrono>    // For the trace timestamps
+#include    <csignal>   // For the crash handler
+#include    <cstring>   // For strlen
+#include    <fcntl.h>   // For opening the dump file
+#ifdef _WIN32
+#include    <io.h>      // For _write and _close
+#define     writeBytes _write
+#define     closeFile _close
+#else
+#include    <unistd.h>  // For write and close
+#define     writeBytes write
+#define     closeFile close
+#endif
+using namespace std; // Use the standard namespace for convenience
+
+TraceEntry Trace::entries[Trace::CAPACITY];
+atomic<uint64_t> Trace::head(0);
+
+// Time origin of the timestamps
+static const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+// Function to record a trace in the ring buffer
+void Trace::record(int level, const char* message, uint64_t first, uint64_t second) {
+    uint64_t index = head.fetch_add(1, memory_order_relaxed);  // Reserve a slot, no lock needed
+    TraceEntry& entry = entries[index & (CAPACITY - 1)];
+
+    // Mark the slot as being written so a concurrent dump skips it
+    entry.sequence.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry.time.store(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count(), memory_order_relaxed);
+    entry.message.store(message, memory_order_relaxed);
+    entry.first.store(first, memory_order_relaxed);
+    entry.second.store(second, memory_order_relaxed);
+    entry.level.store(level, memory_order_relaxed);
+    entry.sequence.store(index + 1, memory_order_release);  // Publish the slot
+}
+
+// Helper to append a number to a buffer without any library call (usable in a signal handler)
+static char* appendNumber(char* out, uint64_t value) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+// Helper to append a string to a buffer, at most limit characters
+static char* appendString(char* out, const char* text, size_t limit) {
+    while (*text && limit-- > 0) {
+        *out++ = *text++;
+    }
+    return out;
+}
+
+// Function to write every trace of the buffer to a file descriptor
+void Trace::dump(int descriptor) {
+    static const char* levelNames[] = {"OFF", "ERROR", "INFO", "DEBUG"};
+    uint64_t end = head.load(memory_order_acquire);
+    uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+
+    for (uint64_t index = begin; index < end; index++) {
+        const TraceEntry& entry = entries[index & (CAPACITY - 1)];
+        uint64_t sequence = entry.sequence.load(memory_order_acquire);
+        uint64_t time = entry.time.load(memory_order_relaxed);
+        const char* message = entry.message.load(memory_order_relaxed);
+        uint64_t first = entry.first.load(memory_order_relaxed);
+        uint64_t second = entry.second.load(memory_order_relaxed);
+        int level = entry.level.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        // Skip slots that are being written or were overwritten while they were read
+        if (sequence != index + 1 || entry.sequence.load(memory_order_relaxed) != sequence || !message) {
+            continue;
+        }
+
+        // Format "[  microseconds] LEVEL message first second"
+        char line[256];
+        char* out = line;
+        *out++ = '[';
+        out = appendNumber(out, time / 1000);
+        out = appendString(out, " us] ", 5);
+        out = appendString(out, levelNames[level >= 0 && level <= TRACE_LEVEL_DEBUG ? level : 0], 5);
+        *out++ = ' ';
+        out = appendString(out, message, 160);
+        *out++ = ' ';
+        out = appendNumber(out, first);
+        *out++ = ' ';
+        out = appendNumber(out, second);
+        *out++ = '\n';
+        if (writeBytes(descriptor, line, static_cast<unsigned>(out - line)) < 0) {
+            return;
+        }
+    }
+}
+
+// Function to write every trace of the buffer to a file
+bool Trace::dumpToFile(const char* filename) {
+#ifdef _WIN32
+    int descriptor = _open(filename, _O_WRONLY | _O_CREAT | _O_TRUNC, 0644);
+#else
+    int descriptor = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (descriptor < 0) {
+        return false;
+    }
+    dump(descriptor);
+    closeFile(descriptor);
+    return true;
+}
+
+// Signal handler that dumps the traces to stderr and lets the default handler end the program
+static void crashHandler(int signalNumber) {
+    const char* header = "\n*** crash, last traces: ***\n";
+    if (writeBytes(2, header, static_cast<unsigned>(strlen(header))) >= 0) {
+        Trace::dump(2);
+    }
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+}
+
+// Function to dump the buffer to stderr when the program crashes
+void Trace::installCrashHandler() {
+    signal(SIGSEGV, crashHandler);
+    signal(SIGABRT, crashHandler);  // Also covers std::terminate after an uncaught exception
+    signal(SIGFPE, crashHandler);
+    signal(SIGILL, crashHandler);
+}
@@ -0,0 +1,72 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>   // For the lock-free ring buffer
+#include <cstdint>  // For uint64_t
+
+// Trace levels, a trace is kept when its level is at most TRACE_LEVEL
+#define TRACE_LEVEL_OFF   0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_INFO  2
+#define TRACE_LEVEL_DEBUG 3
+
+// The level is chosen at compile time (-DTRACE_LEVEL=...); release builds (-DNDEBUG) trace nothing by default
+#ifndef TRACE_LEVEL
+#ifdef NDEBUG
+#define TRACE_LEVEL TRACE_LEVEL_OFF
+#else
+#define TRACE_LEVEL TRACE_LEVEL_DEBUG
+#endif
+#endif
+
+// TraceEntry struct to store one trace inside the ring buffer
+// Every field is atomic so a dump can run while other threads are still tracing.
+struct TraceEntry {
+    std::atomic<uint64_t> sequence;      // Index of the trace + 1, 0 while the slot is being written
+    std::atomic<uint64_t> time;          // Nanoseconds since the program started
+    std::atomic<const char*> message;    // String literal describing the event
+    std::atomic<uint64_t> first;         // First value attached to the event
+    std::atomic<uint64_t> second;        // Second value attached to the event
+    std::atomic<int> level;              // Level of the trace
+};
+
+// Trace class to keep the latest traces in memory instead of printing them
+// Recording a trace is a few relaxed atomic stores into a fixed ring buffer: no lock, no allocation and
+// no system call. The buffer is written out on demand (dumpToFile) or when the program crashes.
+class Trace {
+public:
+    // Method to record a trace (use the TRACE_* macros so disabled levels cost nothing)
+    static void record(int level, const char* message, uint64_t first = 0, uint64_t second = 0);
+    // Method to write every trace of the buffer, oldest first, to a file descriptor (safe inside a signal handler)
+    static void dump(int descriptor);
+    // Method to write every trace of the buffer to a file
+    static bool dumpToFile(const char* filename);
+    // Method to dump the buffer to stderr when the program crashes
+    static void installCrashHandler();
+
+private:
+    static const uint64_t CAPACITY = 4096;  // Number of traces kept (a power of two)
+    static TraceEntry entries[CAPACITY];    // The ring buffer
+    static std::atomic<uint64_t> head;      // Number of traces recorded so far
+};
+
+// Tracing macros; a level above TRACE_LEVEL compiles to nothing and its arguments are not evaluated
+#if TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(...) Trace::record(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define TRACE_ERROR(...) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(...) Trace::record(TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+#define TRACE_INFO(...) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(...) Trace::record(TRACE_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define TRACE_DEBUG(...) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,226 @@
+#include    "undoJournal.h" // Include the header file for the undo journal
+#include    "trace.h"       // Include the trace ring buffer for the debug output
+#include    <algorithm>     // For reverse
+using namespace std; // Use the standard namespace for convenience
+
+// Command struct's setCommand method that initializes the operation type, position and text
+void Command::setCommand(Operation operation, size_t offset, const string& characters) {
+    op = operation;  // Set the operation type (ADD, DELETE, REPLACE)
+    position = offset; // Set the document offset where the text was added or deleted
+    text = characters; // Set the text that was added or deleted
+    reversed = false;  // Only a run of backspaces is kept backwards while it grows
+    TRACE_DEBUG("journal: command op/position", op, position);
+}
+
+// Constructor to create an empty journal
+UndoJournal::UndoJournal(size_t memoryLimit) : limit(memoryLimit), usedBytes(0), openTransactions(0) {}
+
+// Function to record inserted text
+void UndoJournal::recordInsert(size_t position, const string& text, size_t cursorBefore, size_t cursorAfter) {
+    record(Command::ADD, position, text, cursorBefore, cursorAfter);
+}
+
+// Function to record removed text
+void UndoJournal::recordErase(size_t position, const string& text, size_t cursorBefore, size_t cursorAfter) {
+    record(Command::DELETE, position, text, cursorBefore, cursorAfter);
+}
+
+// Function to record a batch replacement
+void UndoJournal::recordReplace(vector<Replacement> ranges, string removed, string inserted, size_t cursorBefore, size_t cursorAfter) {
+    if (ranges.empty()) {
+        return;
+    }
+    Command cmd;
+    cmd.setCommand(Command::REPLACE, ranges.front().position, string());
+    cmd.text = std::move(removed);  // Moved, a replace-all can carry megabytes of text
+    cmd.replacement = std::move(inserted);
+    cmd.ranges = std::move(ranges);
+
+    // A replace-all is never merged with typing; it is one transaction of its own
+    beginTransaction(cursorBefore);
+    usedBytes += sizeof(Command) + cmd.text.capacity() + cmd.replacement.capacity() + cmd.ranges.capacity() * sizeof(Replacement);
+    undoHistory.back().edits.push_back(std::move(cmd));
+    endTransaction(cursorAfter);
+}
+
+// Function to open a transaction; transactions can be nested, only the outer one counts
+void UndoJournal::beginTransaction(size_t cursorBefore) {
+    if (openTransactions++ > 0) {
+        return;
+    }
+    closeRun();
+    // A new edit makes the undone history unreachable
+    for (const Transaction& transaction : redoHistory) {
+        usedBytes -= sizeOf(transaction);
+    }
+    redoHistory.clear();
+
+    Transaction transaction;
+    transaction.cursorBefore = cursorBefore;
+    transaction.cursorAfter = cursorBefore;
+    transaction.coalescing = false;  // Nothing is merged into a grouped operation afterwards
+    undoHistory.push_back(std::move(transaction));
+    usedBytes += sizeof(Transaction);
+}
+
+// Function to close a transaction
+void UndoJournal::endTransaction(size_t cursorAfter) {
+    if (openTransactions == 0 || --openTransactions > 0) {
+        return;
+    }
+    undoHistory.back().cursorAfter = cursorAfter;
+    // A transaction that recorded nothing is not worth an undo step
+    if (undoHistory.back().edits.empty()) {
+        usedBytes -= sizeOf(undoHistory.back());
+        undoHistory.pop_back();
+    }
+    enforceLimit();
+}
+
+// Function to stop merging typing into the last edit
+void UndoJournal::seal() {
+    if (!undoHistory.empty() && openTransactions == 0) {
+        undoHistory.back().coalescing = false;
+        closeRun();
+    }
+}
+
+// Function to take the newest transaction to undo
+const Transaction* UndoJournal::undo() {
+    if (undoHistory.empty() || openTransactions > 0) {
+        return nullptr;
+    }
+    // The transaction moves to the redo history; the bytes used do not change
+    undoHistory.back().coalescing = false;
+    closeRun();
+    redoHistory.push_back(std::move(undoHistory.back()));
+    undoHistory.pop_back();
+    return &redoHistory.back();
+}
+
+// Function to take the newest undone transaction to redo
+const Transaction* UndoJournal::redo() {
+    if (redoHistory.empty() || openTransactions > 0) {
+        return nullptr;
+    }
+    undoHistory.push_back(std::move(redoHistory.back()));
+    redoHistory.pop_back();
+    return &undoHistory.back();
+}
+
+// Function to forget the whole history
+void UndoJournal::clear() {
+    undoHistory.clear();
+    redoHistory.clear();
+    usedBytes = 0;
+    openTransactions = 0;
+}
+
+// Function to change the memory limit
+void UndoJournal::setMemoryLimit(size_t bytes) {
+    limit = bytes;
+    enforceLimit();
+}
+
+// Function to get the number of bytes used by the history
+size_t UndoJournal::memoryUsage() const {
+    return usedBytes;
+}
+
+// Function to add an edit to the history
+void UndoJournal::record(Command::Operation op, size_t position, const string& text, size_t cursorBefore, size_t cursorAfter) {
+    if (text.empty()) {
+        return;
+    }
+
+    // Inside a transaction every edit is simply appended to it
+    if (openTransactions > 0) {
+        Command cmd;
+        cmd.setCommand(op, position, text);
+        usedBytes += sizeof(Command) + cmd.text.capacity();
+        undoHistory.back().edits.push_back(std::move(cmd));
+        return;
+    }
+
+    // A new edit makes the undone history unreachable
+    for (const Transaction& transaction : redoHistory) {
+        usedBytes -= sizeOf(transaction);
+    }
+    redoHistory.clear();
+
+    bool lineBreak = text.find('\n') != string::npos;  // A line split or merge is always its own undo step
+    if (!lineBreak && !undoHistory.empty() && undoHistory.back().coalescing) {
+        Transaction& last = undoHistory.back();
+        Command& edit = last.edits.back();
+        // Typing that continues right after the previous typing grows that run
+        bool continuesTyping = op == Command::ADD && edit.op == Command::ADD && position == edit.position + edit.text.size();
+        // A backspace right before the previous backspaces grows that run
+        bool continuesErasing = op == Command::DELETE && edit.op == Command::DELETE && position + text.size() == edit.position;
+        if (continuesTyping || continuesErasing) {
+            usedBytes -= sizeOf(last);
+            if (continuesTyping) {
+                edit.text += text;
+            } else {
+                // Each backspace removes the character before the run, so the run is kept backwards and grows
+                // at its end; closeRun() turns it around once, instead of moving the whole run every time
+                if (!edit.reversed) {
+                    reverse(edit.text.begin(), edit.text.end());
+                    edit.reversed = true;
+                }
+                edit.text.append(text.rbegin(), text.rend());
+                edit.position = position;
+            }
+            last.cursorAfter = cursorAfter;
+            usedBytes += sizeOf(last);
+            enforceLimit();
+            return;
+        }
+    }
+
+    // Otherwise the edit starts a new transaction
+    closeRun();
+    Transaction transaction;
+    Command cmd;
+    cmd.setCommand(op, position, text);
+    transaction.edits.push_back(std::move(cmd));
+    transaction.cursorBefore = cursorBefore;
+    transaction.cursorAfter = cursorAfter;
+    transaction.coalescing = !lineBreak;
+    usedBytes += sizeOf(transaction);
+    undoHistory.push_back(std::move(transaction));
+    enforceLimit();
+}
+
+// Function to put the text of the last run of backspaces back in document order
+void UndoJournal::closeRun() {
+    if (undoHistory.empty() || undoHistory.back().edits.empty()) {
+        return;
+    }
+    Command& edit = undoHistory.back().edits.back();
+    if (edit.reversed) {
+        reverse(edit.text.begin(), edit.text.end());
+        edit.reversed = false;
+    }
+}
+
+// Function to compute the bytes used by one transaction
+size_t UndoJournal::sizeOf(const Transaction& transaction) {
+    size_t bytes = sizeof(Transaction) + transaction.edits.size() * sizeof(Command);
+    for (const Command& edit : transaction.edits) {
+        bytes += edit.text.capacity() + edit.replacement.capacity() + edit.ranges.capacity() * sizeof(Replacement);
+    }
+    return bytes;
+}
+
+// Function to drop the oldest transactions until the history fits in the limit
+// The newest transaction is always kept so the last operation can be undone.
+void UndoJournal::enforceLimit() {
+    while (usedBytes > limit && !redoHistory.empty()) {
+        usedBytes -= sizeOf(redoHistory.front());
+        redoHistory.erase(redoHistory.begin());
+    }
+    while (usedBytes > limit && undoHistory.size() > 1) {
+        usedBytes -= sizeOf(undoHistory.front());
+        undoHistory.pop_front();
+    }
+}
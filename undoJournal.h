@@ -0,0 +1,85 @@
+#ifndef UNDOJOURNAL_H
+#define UNDOJOURNAL_H
+
+#include <deque>    // For the undo history (oldest transactions are dropped from the front)
+#include <string>   // For the text of every edit
+#include <vector>   // For the edits of a transaction and the redo history
+#include <cstddef>  // For size_t
+#include "pieceTable.h" // For the ranges of a batch replacement
+
+// Command struct to store one edit of the document
+// An edit is anchored at a document offset and carries the whole run of text it inserted or removed,
+// so a burst of typing or of backspaces is a single Command instead of one per keystroke.
+// A REPLACE command stores a whole replace-all: its ranges, the removed texts and the new texts.
+struct Command {
+    enum Operation { ADD, DELETE, REPLACE } op; // Whether the text was inserted, removed or replaced
+    size_t position;                   // Document offset where the text starts
+    std::string text;                  // Inserted or removed text (REPLACE: the removed texts, one after the other)
+    std::string replacement;           // REPLACE only: the new texts, one after the other
+    std::vector<Replacement> ranges;   // REPLACE only: the replaced ranges, with offsets from before the replacement
+    bool reversed;                     // DELETE only: true while a run of backspaces keeps its text backwards
+
+    // Function to set the command's operation, position and text
+    void setCommand(Operation operation, size_t offset, const std::string& characters);
+};
+
+// Transaction struct to group the edits that are undone and redone together
+struct Transaction {
+    std::vector<Command> edits; // Edits in the order they were applied
+    size_t cursorBefore;        // Cursor offset to restore on undo
+    size_t cursorAfter;         // Cursor offset to restore on redo
+    bool coalescing;            // True while typing may still be merged into the last edit
+};
+
+// UndoJournal class to keep the undo and redo history of the document
+// Consecutive typing and consecutive backspaces are merged into run-length edits, multi step
+// operations are grouped into one transaction, and the oldest history is dropped once the
+// journal uses more than its memory limit.
+class UndoJournal {
+public:
+    // Constructor to create an empty journal with a memory limit in bytes
+    explicit UndoJournal(size_t memoryLimit = 64 << 20);
+
+    // Method to record inserted text, merged into the previous typing when it continues it
+    void recordInsert(size_t position, const std::string& text, size_t cursorBefore, size_t cursorAfter);
+    // Method to record removed text, merged into the previous backspaces when it continues them
+    void recordErase(size_t position, const std::string& text, size_t cursorBefore, size_t cursorAfter);
+    // Method to record a batch replacement as one undo step
+    void recordReplace(std::vector<Replacement> ranges, std::string removed, std::string inserted, size_t cursorBefore, size_t cursorAfter);
+    // Methods to group every edit recorded between them into one transaction
+    void beginTransaction(size_t cursorBefore);
+    void endTransaction(size_t cursorAfter);
+    // Method to stop merging new typing into the last edit (called when the cursor jumps)
+    void seal();
+
+    // Method to take the newest transaction to undo (nullptr when there is none)
+    // The transaction stays valid until the journal is changed again.
+    const Transaction* undo();
+    // Method to take the newest undone transaction to redo (nullptr when there is none)
+    const Transaction* redo();
+    // Method to forget the whole history
+    void clear();
+
+    // Method to change the memory limit, dropping old history if needed
+    void setMemoryLimit(size_t bytes);
+    // Method to get the number of bytes used by the history
+    size_t memoryUsage() const;
+
+private:
+    std::deque<Transaction> undoHistory;  // Transactions that can be undone, oldest first
+    std::vector<Transaction> redoHistory; // Transactions that can be redone, newest undo last
+    size_t limit;                         // Maximum number of bytes kept in the history
+    size_t usedBytes;                     // Bytes used by both histories
+    int openTransactions;                 // Nesting depth of beginTransaction calls
+
+    // Helper to add an edit to the history, merging it when possible
+    void record(Command::Operation op, size_t position, const std::string& text, size_t cursorBefore, size_t cursorAfter);
+    // Helper to put the text of the last run of backspaces back in document order once it stops growing
+    void closeRun();
+    // Helper to compute the bytes used by one transaction
+    static size_t sizeOf(const Transaction& transaction);
+    // Helper to drop the oldest transactions until the history fits in the limit
+    void enforceLimit();
+};
+
+#endif // UNDOJOURNAL_H